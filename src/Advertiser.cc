@@ -3,11 +3,14 @@
 #include <click/error.hh>
 #include <clicknet/ether.h>
 #include <clicknet/ip.h>
+#include <click/packet_anno.hh>
 
 // Local imports
 #include "Advertiser.hh"
 #include "structs/ICMPAdvertisement.hh"
+#include "structs/ICMPRouterEntry.hh"
 #include "structs/MobilityAgentAdvertisementExtension.hh"
+#include "structs/WireViews.hh"
 #include "utils/Configurables.hh"
 #include "utils/HelperFunctions.hh"
 #include <iostream>
@@ -16,86 +19,339 @@
 #define MAX_INITIAL_ADVERT_INTERVAL 16
 #define MAX_INITIAL_ADVERTISEMENTS 3
 #define MAX_RESPONSE_DELAY 2
+#define MIN_DELAY_BETWEEN_RAS 3
+
+enum { C_ADVERTISEMENTS, C_SOLICITATIONS_ANSWERED, C_SOLICITATIONS_COALESCED, C_SOLICITATIONS_RATE_LIMITED,
+	C_SOLICITATIONS_UNMATCHED, C_RESPONSES_UNICAST, C_RESPONSES_MULTICAST, C_END };
 
 CLICK_DECLS
-Advertiser::Advertiser(): _advertisementCounter(0), _advertisementTimer(this){}
+Advertiser::Advertiser(): _weighted(false), _start(false), _unicast(1), _advertisementTimer(this){}
 
 Advertiser::~ Advertiser(){}
 
 int Advertiser::configure(Vector<String> &conf, ErrorHandler *errh) {
+	// INTERFACE and CARE_OF can be given many times, take them out before the other arguments are parsed
+	Vector<String> interfaces, careOfAddresses;
+	for (int i = 0; i < conf.size(); ) {
+		String keyword, rest;
+		if (cp_keyword(conf[i], &keyword, &rest) && (keyword == "INTERFACE" || keyword == "CARE_OF")) {
+			(keyword == "INTERFACE" ? interfaces : careOfAddresses).push_back(cp_unquote(rest));
+			conf.erase(conf.begin() + i);
+		} else
+			i++;
+	}
+	bool hasPrivate = false;
+	unsigned responseRate = 100;
+	unsigned responseBurst = 50;
 	if (cp_va_kparse(
 		conf, this, errh,
-		"PRIVATE", cpkM, cpIPAddress, &_routerAddressPrivate, \
+		"PRIVATE", cpkC, &hasPrivate, cpIPAddress, &_routerAddressPrivate, \
 		"PUBLIC", cpkM, cpIPAddress, &_routerAddressPublic, \
+		"START", cpkN, cpBool, &_start, \
+		"UNICAST", cpkN, cpUnsigned, &_unicast, \
+		"RESPONSE_RATE", cpkN, cpUnsigned, &responseRate, \
+		"RESPONSE_BURST", cpkN, cpUnsigned, &responseBurst, \
 		cpEnd) < 0) {
 			return -1;
 	}
+	if (hasPrivate && _parseInterface(_routerAddressPrivate.unparse(), errh) < 0)
+		return -1;
+	for (int i = 0; i < interfaces.size(); i++)
+		if (_parseInterface(interfaces[i], errh) < 0)
+			return -1;
+	if (_interfaces.empty())
+		return errh->error("PRIVATE or INTERFACE is required");
+	for (int i = 0; i < careOfAddresses.size(); i++)
+		if (_parseCareOf(careOfAddresses[i], errh) < 0)
+			return -1;
+	if (_careOfAddresses.empty()) {
+		_careOfAddresses.push_back(_routerAddressPublic);
+		_careOfWeights.push_back(1);
+	}
+	if (responseRate < 1 || responseBurst < 1)
+		return errh->error("RESPONSE_RATE and RESPONSE_BURST must be at least 1");
+	_responseTokens.assign(responseRate, responseBurst);
+	_responseTokens.set(responseBurst);
+	_counters.initialize(C_END);
+	return 0;
+}
+
+// "<address> VLAN 11 INTERVAL 60" becomes the arguments "<address>", "VLAN 11", "INTERVAL 60"
+static void keywordArguments(const String& conf, Vector<String>& args) {
+	Vector<String> words;
+	cp_spacevec(conf, words);
+	for (int i = 0; i < words.size(); i++) {
+		if (i > 0 && i + 1 < words.size()) {
+			args.push_back(words[i] + " " + words[i + 1]);
+			i++;
+		} else
+			args.push_back(words[i]);
+	}
+}
+
+int Advertiser::_parseInterface(const String& conf, ErrorHandler* errh) {
+	Interface interface;
+	unsigned vlan = 0;
+	int paint = -1;
+	unsigned interval = MaxAdvertisementInterval;
+	unsigned lifetime = AdvertisementLifetime;
+	Vector<String> args;
+	keywordArguments(conf, args);
+	if (cp_va_kparse(
+		args, this, errh,
+		"ADDRESS", cpkP+cpkM, cpIPAddress, &interface.address, \
+		"VLAN", cpkN, cpUnsigned, &vlan, \
+		"PAINT", cpkN, cpInteger, &paint, \
+		"INTERVAL", cpkN, cpUnsigned, &interval, \
+		"LIFETIME", cpkN, cpUnsigned, &lifetime, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	// The minimum interval (0.75 INTERVAL) must be at least 3 seconds
+	if (interval < 4 || interval > 1800)
+		return errh->error("interface %s: INTERVAL must be between 4 and 1800 seconds", interface.address.unparse().c_str());
+	if (lifetime < interval || lifetime > 9000)
+		return errh->error("interface %s: LIFETIME must be between INTERVAL and 9000 seconds", interface.address.unparse().c_str());
+	if (vlan > 0xFFF)
+		return errh->error("interface %s: VLAN must be at most 4095", interface.address.unparse().c_str());
+	if (vlan) {
+		if (_vlanInterfaces.find(htons(vlan)) != _vlanInterfaces.end())
+			return errh->error("interface %s: VLAN %u is already used", interface.address.unparse().c_str(), vlan);
+		_vlanInterfaces.set(htons(vlan), _interfaces.size());
+	}
+	if (paint != -1) {
+		if (paint < 0 || paint > 255)
+			return errh->error("interface %s: PAINT must be between 0 and 255", interface.address.unparse().c_str());
+		if (_paintInterfaces.find(paint) != _paintInterfaces.end())
+			return errh->error("interface %s: PAINT %d is already used", interface.address.unparse().c_str(), paint);
+		_paintInterfaces.set(paint, _interfaces.size());
+	}
+	interface.vlan = vlan;
+	interface.paint = paint;
+	interface.interval = interval * 1000;
+	interface.lifetime = lifetime;
+	interface.advertisementCounter = 0;
+	interface.advertisementTemplate = 0;
+	interface.multicastResponse = false;
+	_interfaces.push_back(interface);
 	return 0;
 }
 
-int Advertiser::initialize(ErrorHandler *) {
+int Advertiser::_parseCareOf(const String& conf, ErrorHandler* errh) {
+	IPAddress address;
+	unsigned weight = 1;
+	Vector<String> args;
+	keywordArguments(conf, args);
+	if (cp_va_kparse(
+		args, this, errh,
+		"ADDRESS", cpkP+cpkM, cpIPAddress, &address, \
+		"WEIGHT", cpkN, cpUnsigned, &weight, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (weight < 1 || weight > 255)
+		return errh->error("care of address %s: WEIGHT must be between 1 and 255", address.unparse().c_str());
+	if (_careOfAddresses.size() == MAX_CARE_OF_ADDRESSES)
+		return errh->error("at most %d care of addresses", MAX_CARE_OF_ADDRESSES);
+	for (int i = 0; i < _careOfAddresses.size(); i++)
+		if (_careOfAddresses[i] == address)
+			return errh->error("care of address %s is given twice", address.unparse().c_str());
+	_careOfAddresses.push_back(address);
+	_careOfWeights.push_back(weight);
+	if (weight != 1)
+		_weighted = true;
+	return 0;
+}
+
+int Advertiser::initialize(ErrorHandler *errh) {
+	if (noutputs() > 1 && noutputs() != _interfaces.size())
+		return errh->error("%d outputs for %d interfaces", noutputs(), _interfaces.size());
 	// Initialize rand used for the advertisement timer
-	srand (_routerAddressPrivate.addr());
+	srand (_interfaces[0].address.addr());
 	// Initialize timer object
 	_advertisementTimer.initialize(this);
+	Timestamp now = Timestamp::now_steady();
+	for (int i = 0; i < _interfaces.size(); i++) {
+		_buildTemplate(_interfaces[i]);
+		if (_start)
+			_schedule(i, now + Timestamp::make_msec(generateRandomNumber(0, _interfaces[i].interval)));
+	}
 	return 0;
 }
 
+void Advertiser::cleanup(CleanupStage) {
+	for (int i = 0; i < _interfaces.size(); i++) {
+		if (_interfaces[i].advertisementTemplate)
+			_interfaces[i].advertisementTemplate->kill();
+		_interfaces[i].advertisementTemplate = 0;
+	}
+}
+
 void Advertiser::run_timer(Timer* t){
 	if (t == &_advertisementTimer){
-		// Reschedule the timer
-		unsigned int interval = generateRandomNumber(MinAdvertisementInterval*1000,
-							     MaxAdvertisementInterval*1000);
-		// Router advertisement condition
-		/*
-		if (_advertisementCounter <= MAX_INITIAL_ADVERTISEMENTS) {
-			if (interval > MAX_INITIAL_ADVERT_INTERVAL*1000)
-				interval = MAX_INITIAL_ADVERT_INTERVAL*1000;
+		Timestamp now = Timestamp::now_steady();
+		int interface;
+		Timestamp deadline;
+		while (_deadlines.popExpired(now, interface, deadline)) {
+			if (interface < 0) {
+				interface = -interface - 1;
+				// Skip responses that a periodic advertisement already sent
+				if (deadline == _interfaces[interface].response)
+					_sendResponse(interface);
+				continue;
+			}
+			// Skip deadlines that an answer to a solicitation replaced
+			if (deadline != _interfaces[interface].next)
+				continue;
+			// Reschedule the interface
+			unsigned int interval = generateRandomNumber(_interfaces[interface].interval * 3 / 4,
+								     _interfaces[interface].interval);
+			_schedule(interface, now + Timestamp::make_msec(interval));
+			// Send advertisement, it also answers the pending solicitations
+			_interfaces[interface].response = Timestamp();
+			_sendAdvertisement(interface, IPAddress());
 		}
-		*/
-		// Agent advertisement condition
-		/*
-		if (interval > (AdvertisementLifetime/3)*1000)
-			interval = (AdvertisementLifetime/3)*1000;
-		*/
-		_advertisementTimer.reschedule_after_msec(interval);
-		// Send advertisement
-		_generateAdvertisement();
+		if (!_deadlines.empty())
+			_advertisementTimer.schedule_at_steady(_deadlines.nextDeadline());
+	}
+}
+
+void Advertiser::_schedule(int interface, const Timestamp& deadline){
+	_interfaces[interface].next = deadline;
+	_deadlines.schedule(interface, deadline);
+	if (!_advertisementTimer.scheduled() || deadline < _advertisementTimer.expiry_steady())
+		_advertisementTimer.schedule_at_steady(deadline);
+}
+
+void Advertiser::_scheduleResponse(int interface, const Timestamp& deadline){
+	_interfaces[interface].response = deadline;
+	_deadlines.schedule(-interface - 1, deadline);
+	if (!_advertisementTimer.scheduled() || deadline < _advertisementTimer.expiry_steady())
+		_advertisementTimer.schedule_at_steady(deadline);
+}
+
+void Advertiser::_sendResponse(int i){
+	Interface& interface = _interfaces[i];
+	interface.response = Timestamp();
+	Timestamp now = Timestamp::now_steady();
+	if (!interface.multicastResponse) {
+		for (int j = 0; j < interface.solicitors.size(); j++)
+			_sendAdvertisement(i, interface.solicitors[j]);
+		_counters.add(C_RESPONSES_UNICAST, interface.solicitors.size());
+	} else {
+		_sendAdvertisement(i, IPAddress());
+		_counters.add(C_RESPONSES_MULTICAST);
+	}
+	// A solicitation starts the periodic advertisements, a multicast one restarts their interval
+	if (!interface.next || interface.multicastResponse) {
+		unsigned int interval = generateRandomNumber(interface.interval * 3 / 4, interface.interval);
+		_schedule(i, now + Timestamp::make_msec(interval));
 	}
 }
 
-void Advertiser::respondToSolicitation(){
+int Advertiser::_solicitationInterface(const Packet* solicitation) const {
+	if (_interfaces.size() == 1)
+		return 0;
+	// The VLAN or the paint of the link it came in on tells the interface
+	uint16_t tci = VLAN_TCI_ANNO(solicitation) & htons(0xFFF);
+	if (tci) {
+		HashTable<uint16_t, int>::const_iterator it = _vlanInterfaces.find(tci);
+		if (it != _vlanInterfaces.end())
+			return it.value();
+	}
+	HashTable<uint8_t, int>::const_iterator it = _paintInterfaces.find(PAINT_ANNO(solicitation));
+	if (it != _paintInterfaces.end())
+		return it.value();
+	// Else it came in on a link without VLAN or paint: its source network tells which one, an
+	// away mobile node solicits from its home address and gets the first of these links
+	IPAddress source = ((const click_ip*) solicitation->data())->ip_src;
+	int first = -1;
+	for (int i = 0; i < _interfaces.size(); i++) {
+		if (_interfaces[i].vlan || _interfaces[i].paint != -1)
+			continue;
+		if (sameNetwork(source, _interfaces[i].address))
+			return i;
+		if (first == -1)
+			first = i;
+	}
+	return first;
+}
+
+void Advertiser::respondToSolicitation(const Packet* solicitation){
+	int i = _solicitationInterface(solicitation);
+	if (i == -1) {
+		LOG("[Advertiser] Solicitation from an unknown link, not responding");
+		_counters.add(C_SOLICITATIONS_UNMATCHED);
+		return;
+	}
+	Interface& interface = _interfaces[i];
+	IPAddress solicitor = ((const click_ip*) solicitation->data())->ip_src;
+	if (interface.response) {
+		// Join the pending response instead of postponing it
+		LOG("[Advertiser] Solicitation joins the pending response");
+		_counters.add(C_SOLICITATIONS_COALESCED);
+		if (!interface.multicastResponse) {
+			bool known = false;
+			for (int j = 0; j < interface.solicitors.size() && !known; j++)
+				known = interface.solicitors[j] == solicitor;
+			if (!known && interface.solicitors.size() < (int) _unicast && solicitor)
+				interface.solicitors.push_back(solicitor);
+			else if (!known)
+				interface.multicastResponse = true;
+		}
+		return;
+	}
+	_responseTokens.refill();
+	if (!_responseTokens.remove_if(1)) {
+		LOG("[Advertiser] Too many solicitations, not responding");
+		_counters.add(C_SOLICITATIONS_RATE_LIMITED);
+		return;
+	}
 	LOG("[Advertiser] Responding to solicitation");
+	_counters.add(C_SOLICITATIONS_ANSWERED);
 	unsigned int delay = generateRandomNumber(0, MAX_RESPONSE_DELAY*1000);
-	_advertisementTimer.schedule_after_msec(delay);
+	Timestamp deadline = Timestamp::now_steady() + Timestamp::make_msec(delay);
+	interface.solicitors.clear();
+	interface.multicastResponse = _unicast == 0 || !solicitor;
+	if (!interface.multicastResponse)
+		interface.solicitors.push_back(solicitor);
+	// Multicast advertisements of an interface are at least MIN_DELAY_BETWEEN_RAS apart
+	Timestamp earliest = interface.lastMulticast + Timestamp::make_sec(MIN_DELAY_BETWEEN_RAS);
+	if (interface.lastMulticast && deadline < earliest)
+		deadline = earliest;
+	_scheduleResponse(i, deadline);
 }
 
-void Advertiser::_generateAdvertisement() {
-	LOG("[Advertiser] Sending ICMP router advertisement");
+void Advertiser::_buildTemplate(Interface& interface) {
 	int tailroom = 0;
 	int headroom = sizeof(click_ether) + 4;
+	int careOfAddresses = _careOfAddresses.size();
 	int packetsize =
 	sizeof(click_ip) +
 	sizeof(ICMPAdvertisement) +
-	sizeof(MobilityAgentAdvertisementExtension);
+	MobilityExtensionView::CARE_OF_ADDRESSES + 4 * careOfAddresses +
+	(_weighted ? CareOfWeightsView::WEIGHTS + careOfAddresses : 0);
 
 	WritablePacket* packet =
 	Packet::make(headroom, 0, packetsize, tailroom);
 	memset(packet->data(), 0, packet->length());
 
-	// IP header
+	// IP header, ip_id is patched in per advertisement
 	click_ip *iph = (click_ip *) packet->data();
 	iph->ip_v = 4;
   	iph->ip_hl = sizeof(click_ip) >> 2;
 	iph->ip_len = htons(packet->length());
-	iph->ip_id = htons(_advertisementCounter);
+	iph->ip_id = 0;
   	iph->ip_p = 1;
 	iph->ip_tos = 0x00;
   	iph->ip_ttl = 1;
 	iph->ip_dst = AdvertisementAddress.in_addr();
-	iph->ip_src = _routerAddressPrivate.in_addr();
+	iph->ip_src = interface.address.in_addr();
 	iph->ip_sum = click_in_cksum((unsigned char *)iph, sizeof(click_ip));
 	packet->set_dst_ip_anno(AdvertisementAddress);
+	// The copies keep the annotations
+	if (interface.vlan)
+		SET_VLAN_TCI_ANNO(packet, htons(interface.vlan));
 
 	// ICMP advertisement
 	ICMPAdvertisement* advertisement =
@@ -106,45 +362,91 @@ void Advertiser::_generateAdvertisement() {
 	// Number of router addresses advertised
 	advertisement->numAddrs = 1;
 	advertisement->addrEntrySize = 2;
-	advertisement->lifetime = htons(AdvertisementLifetime);
+	advertisement->lifetime = htons(interface.lifetime);
 	advertisement->routerAddress = _routerAddressPublic.addr();
 	advertisement->preferenceLevel = htonl(0x1);
 
-	// Mobility agent advertisement extension
+	// Mobility agent advertisement extension with all care of addresses, the sequence number
+	// is patched in per advertisement
+	unsigned char* data = packet->data() + sizeof(click_ip) + sizeof(ICMPAdvertisement);
+	MobilityExtensionView extension = MobilityExtensionView::make(data, packet->end_data() - data, careOfAddresses);
+	extension.setSequenceNumber(0);
+	extension.setRegistrationLifetime(registrationLifetime);
+	extension.setFlags(MobilityExtensionView::FLAG_R | MobilityExtensionView::FLAG_H | MobilityExtensionView::FLAG_F);
+	for (int i = 0; i < careOfAddresses; i++)
+		extension.setCareOfAddress(_careOfAddresses[i], i);
+
+	// The weights follow in their own extension, only if they are not all 1
+	if (_weighted) {
+		data += MobilityExtensionView::CARE_OF_ADDRESSES + 4 * careOfAddresses;
+		CareOfWeightsView weights = CareOfWeightsView::make(data, packet->end_data() - data, careOfAddresses);
+		for (int i = 0; i < careOfAddresses; i++)
+			weights.setWeight(_careOfWeights[i], i);
+	}
+
+	// Checksum
+	advertisement->checksum =
+	click_in_cksum((unsigned char *) advertisement, packet->end_data() - (unsigned char*) advertisement);
+	interface.advertisementTemplate = packet;
+}
+
+void Advertiser::_sendAdvertisement(int i, IPAddress destination) {
+	LOG("[Advertiser] Sending ICMP router advertisement");
+	Interface& interface = _interfaces[i];
+	WritablePacket* packet = interface.advertisementTemplate->clone()->uniqueify();
+	if (!packet)
+		return;
+	click_ip *iph = (click_ip *) packet->data();
+	if (destination) {
+		// Unicast response, replace the advertisement address in the header and its checksum
+		uint32_t addr = destination.addr();
+		uint16_t* old = (uint16_t*) &iph->ip_dst;
+		uint16_t* address = (uint16_t*) &addr;
+		iph->ip_sum = updateChecksum(iph->ip_sum, old[0], address[0]);
+		iph->ip_sum = updateChecksum(iph->ip_sum, old[1], address[1]);
+		iph->ip_dst = destination.in_addr();
+		packet->set_dst_ip_anno(destination);
+	} else
+		interface.lastMulticast = Timestamp::now_steady();
+
+	// The template has ip_id and sequence number 0, add the new values to the checksums
+	uint16_t sequenceNumber = htons(interface.advertisementCounter);
+	iph->ip_id = sequenceNumber;
+	iph->ip_sum = updateChecksum(iph->ip_sum, 0, sequenceNumber);
+	ICMPAdvertisement* advertisement =
+	(ICMPAdvertisement*) (packet->data() + sizeof(click_ip));
 	MobilityAgentAdvertisementExtension* extension =
 	(MobilityAgentAdvertisementExtension*) (packet->data() +
 					       sizeof(click_ip) +
                                                sizeof(ICMPAdvertisement));
-	extension->type = 16;
-	extension->length = 6+(4*1);
-	extension->sequenceNumber = htons(_advertisementCounter);
+	extension->sequenceNumber = sequenceNumber;
+	advertisement->checksum = updateChecksum(advertisement->checksum, 0, sequenceNumber);
+
 	// Keep track of amount of advertisements were sent
-	_advertisementCounter++;
+	interface.advertisementCounter++;
 	// Sequence numbers only go from 0 to 0xffff (65535)
-	if (_advertisementCounter >= 65536) {
-		_advertisementCounter = 256;
-	}
-	extension->registrationLifetime = htons(registrationLifetime);
-	extension->R = 1;
-	extension->B = 0;
-	extension->H = 1;
-	extension->F = 1;
-	extension->M = 0;
-	extension->G = 0;
-	extension->r = 0;
-	extension->T = 0;
-	extension->U = 0;
-	extension->X = 0;
-	extension->I = 0;
-	extension->reserved = 0;
-	extension->careOfAddress = _routerAddressPublic.addr();
-
-	// Checksum
-	advertisement->checksum =
-	click_in_cksum((unsigned char *) advertisement,
-		       sizeof(ICMPAdvertisement) + sizeof(MobilityAgentAdvertisementExtension));
+	if (interface.advertisementCounter >= 65536) {
+		interface.advertisementCounter = 256;
+	}
 	// Sent the advertisement to neighboring interface
-	output(0).push(packet);
+	_counters.add(C_ADVERTISEMENTS);
+	output(noutputs() == 1 ? 0 : i).push(packet);
+}
+
+void* Advertiser::cast(const char* name){
+	if (strcmp(name, "MetricsSource") == 0)
+		return static_cast<MetricsSource*>(this);
+	return Element::cast(name);
+}
+
+void Advertiser::writeMetrics(StringAccum& sa) const {
+	writeMetric(sa, this, "advertisements_sent_total", _counters.value(C_ADVERTISEMENTS));
+	writeMetric(sa, this, "solicitations_answered_total", _counters.value(C_SOLICITATIONS_ANSWERED));
+	writeMetric(sa, this, "solicitations_coalesced_total", _counters.value(C_SOLICITATIONS_COALESCED));
+	writeMetric(sa, this, "solicitations_rate_limited_total", _counters.value(C_SOLICITATIONS_RATE_LIMITED));
+	writeMetric(sa, this, "solicitations_unmatched_total", _counters.value(C_SOLICITATIONS_UNMATCHED));
+	writeMetric(sa, this, "solicitation_responses_total", _counters.value(C_RESPONSES_UNICAST), "mode=\"unicast\"");
+	writeMetric(sa, this, "solicitation_responses_total", _counters.value(C_RESPONSES_MULTICAST), "mode=\"multicast\"");
 }
 
 CLICK_ENDDECLS
@@ -2,36 +2,137 @@
 #define CLICK_ADVERTISER_HH
 #include <click/element.hh>
 #include <click/timer.hh>
+#include <click/hashtable.hh>
+#include <click/tokenbucket.hh>
+
+// Local imports
+#include "utils/Metrics.hh"
+#include "utils/ExpiryHeap.hh"
+
 CLICK_DECLS
 
 /*
- *	Click element that will send advertisements
+ *	Click element that will send advertisements, on one or many private networks
+ *	- every private network is an interface: PRIVATE, and one per INTERFACE argument
+ *	  INTERFACE "<address> [VLAN id] [PAINT c] [INTERVAL s] [LIFETIME s]"
+ *	  address is the source of its advertisements, INTERVAL the maximum advertisement
+ *	  interval (default MaxAdvertisementInterval) and LIFETIME the advertisement lifetime
+ *	  (default AdvertisementLifetime)
+ *	- the care of addresses of all interfaces are PUBLIC, or the CARE_OF arguments
+ *	  CARE_OF "<address> [WEIGHT n]"
+ *	  the mobile nodes spread over them by a hash of their home address, an address of weight
+ *	  n (1 to 255, default 1) gets n shares of them; the weights follow the mobility agent
+ *	  advertisement extension in a skippable extension (see CareOfWeightsView), which is left
+ *	  out if all weights are 1 (at most MAX_CARE_OF_ADDRESSES addresses); every care of address
+ *	  must be delivered locally by the agent (see CareOfAgent in library/ha.click)
+ *	- with one output, the advertisements of all interfaces leave on output 0 and carry the
+ *	  VLAN of their interface in the VLAN TCI annotation (see VLANEncap), with more outputs
+ *	  interface i sends on output i
+ *	- one timer and one deadline heap schedule all interfaces, an interface advertises every
+ *	  0.75 to 1 INTERVAL once it answered its first solicitation, or from the start with START
+ *	  true (the first advertisement of each interface at a random time within its INTERVAL,
+ *	  so many interfaces do not advertise at once)
+ *	- a solicitation is answered on the interface of its VLAN TCI annotation, or else of its
+ *	  paint annotation (PAINT c of the interface, see Paint; unpainted packets have color 0),
+ *	  or else on an interface without VLAN and PAINT: the one of its source network, or the
+ *	  first one (an away mobile node solicits from its home address); if every interface has a
+ *	  VLAN or PAINT and none matches, the solicitation is not answered
+ *	- the solicitations of an interface within the response window (0 to MAX_RESPONSE_DELAY
+ *	  after the first) are answered together: a later solicitation joins the pending response
+ *	  instead of delaying it, and a periodic advertisement before it answers them all
+ *	- responses start at most RESPONSE_RATE times per second (bursts of RESPONSE_BURST), more
+ *	  solicitations are not answered, and multicast responses of an interface are at least
+ *	  MIN_DELAY_BETWEEN_RAS apart (RFC 1256)
+ *	- a response to at most UNICAST solicitors (default 1, 0 to always multicast) goes to each
+ *	  of them by unicast, a response to more of them is one multicast advertisement
+ *	- the advertisement of an interface is built once at initialize, every advertisement is a
+ *	  copy of it with its sequence number and IP id patched in, the checksums are updated
+ *	  incrementally
+ *	Output 0 (or 0..n-1) ==> advertisements
+ *	Metrics (see MetricsExporter): advertisements sent, solicitations answered, coalesced,
+ *	rate limited and from an unknown link, responses sent by unicast and multicast
 */
-class Advertiser : public Element {
+class Advertiser : public Element, public MetricsSource {
 	public:
 		Advertiser();
 		~Advertiser();
 
 		const char *class_name() const	{ return "Advertiser"; }
-		const char *port_count() const	{ return "0/1"; }
+		const char *port_count() const	{ return "0/1-"; }
 		const char *processing() const	{ return PUSH; }
 		int configure(Vector<String>&, ErrorHandler*);
 		int initialize(ErrorHandler *);
+		void cleanup(CleanupStage);
 		void run_timer(Timer* t);
+		void* cast(const char*);
+		void writeMetrics(StringAccum&) const;
 
 		// This method is called by the RoutingElement when the agent received a solicitation
-		void respondToSolicitation();
+		void respondToSolicitation(const Packet* solicitation);
 
 	private:
+		struct Interface {
+			IPAddress address;
+			// VLAN id, 0 if the interface has no VLAN
+			uint16_t vlan;
+			// Paint annotation of its solicitations, -1 if the interface has no PAINT
+			int paint;
+			// Maximum advertisement interval, in milliseconds
+			unsigned interval;
+			uint16_t lifetime;
+			unsigned int advertisementCounter;
+			// Advertisement with sequence number and IP id 0
+			Packet* advertisementTemplate;
+			// Deadline of the next advertisement, the heap may hold older ones
+			Timestamp next;
+			// Deadline of the pending response to solicitations, 0 if none is pending
+			Timestamp response;
+			// Sources of the pending solicitations, up to UNICAST of them
+			Vector<IPAddress> solicitors;
+			// More than UNICAST solicitors, or one that has no address yet
+			bool multicastResponse;
+			Timestamp lastMulticast;
+		};
+
 		// Private methods
-		void _generateAdvertisement();
+		int _parseInterface(const String& conf, ErrorHandler* errh);
+		int _parseCareOf(const String& conf, ErrorHandler* errh);
+		void _buildTemplate(Interface& interface);
+		void _schedule(int interface, const Timestamp& deadline);
+		void _scheduleResponse(int interface, const Timestamp& deadline);
+		void _sendResponse(int interface);
+		// Send the advertisement of an interface to destination (0 for the advertisement address)
+		void _sendAdvertisement(int interface, IPAddress destination);
+		// Interface a solicitation arrived on, -1 if none matches
+		int _solicitationInterface(const Packet* solicitation) const;
 
 		// Private attributes
 		IPAddress _routerAddressPrivate; // The private router address
 		IPAddress _routerAddressPublic;
-		unsigned int _advertisementCounter;
+		Vector<Interface> _interfaces;
+		// Advertised care of addresses and their weights, true if a weight is not 1
+		Vector<IPAddress> _careOfAddresses;
+		Vector<uint8_t> _careOfWeights;
+		bool _weighted;
+		bool _start;
+		unsigned _unicast;
+
+		// Limits the responses to solicitations of all interfaces (RESPONSE_RATE, RESPONSE_BURST)
+		TokenBucket _responseTokens;
+
+		// Interfaces by VLAN TCI (network byte order)
+		HashTable<uint16_t, int> _vlanInterfaces;
+		// Interfaces by paint annotation
+		HashTable<uint8_t, int> _paintInterfaces;
+
+		// Next advertisement deadline of every interface, the timer fires at the earliest
+		// Interface i has key i for its periodic advertisements and key -i - 1 for its responses
+		ExpiryHeap<int> _deadlines;
 		Timer _advertisementTimer;
 
+		// Advertisements sent and solicitations handled, counted per thread
+		MetricCounters _counters;
+
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,195 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <clicknet/ether.h>
+#include <clicknet/udp.h>
+#include <clicknet/ip.h>
+
+// Local imports
+#include "CorrespondentSource.hh"
+#include <click/standard/scheduleinfo.hh>
+
+#define MAX_BURST 64
+#define MIN_LENGTH 60
+#define MAX_LENGTH 1514
+
+CLICK_DECLS
+CorrespondentSource::CorrespondentSource(): _task(this), _timer(&_task), _destinations(1), _length(64), _rate(0), _burst(32), _active(true), _next(0), _count(0){}
+
+CorrespondentSource::~ CorrespondentSource(){}
+
+int CorrespondentSource::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"SRC", cpkM, cpIPAddress, &_source, \
+		"DST", cpkM, cpIPAddress, &_destination, \
+		"SRCETH", cpkM, cpEthernetAddress, &_sourceEther, \
+		"DSTETH", cpkM, cpEthernetAddress, &_destinationEther, \
+		"DESTINATIONS", cpkN, cpUnsigned, &_destinations, \
+		"LENGTH", cpkN, cpUnsigned, &_length, \
+		"RATE", cpkN, cpUnsigned, &_rate, \
+		"BURST", cpkN, cpUnsigned, &_burst, \
+		"ACTIVE", cpkN, cpBool, &_active, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_destinations < 1)
+		return errh->error("DESTINATIONS must be at least 1");
+	if (_length < MIN_LENGTH || _length > MAX_LENGTH)
+		return errh->error("LENGTH must be between %d and %d", MIN_LENGTH, MAX_LENGTH);
+	if (_burst < 1 || _burst > MAX_BURST)
+		return errh->error("BURST must be between 1 and %d", MAX_BURST);
+	_setRate(_rate);
+	_buildTemplate();
+	return 0;
+}
+
+int CorrespondentSource::initialize(ErrorHandler *errh) {
+	ScheduleInfo::initialize_task(this, &_task, errh);
+	_timer.initialize(this);
+	return 0;
+}
+
+void CorrespondentSource::_setRate(unsigned rate) {
+	_rate = rate;
+	if (_rate)
+		_tokens.assign(_rate, _rate < 200 * _burst ? _burst : _rate / 200);
+	else
+		_tokens.assign(true);
+	_tokens.set(_burst);
+}
+
+void CorrespondentSource::_buildTemplate() {
+	memset(_template, 0, sizeof(_template));
+	click_ether* ethh = (click_ether*) _template;
+	memcpy(ethh->ether_shost, _sourceEther.data(), 6);
+	memcpy(ethh->ether_dhost, _destinationEther.data(), 6);
+	ethh->ether_type = htons(ETHERTYPE_IP);
+
+	click_ip* iph = (click_ip*) (_template + sizeof(click_ether));
+	iph->ip_v = 4;
+	iph->ip_hl = sizeof(click_ip) >> 2;
+	iph->ip_len = htons(_length - sizeof(click_ether));
+	iph->ip_p = IP_PROTO_UDP;
+	iph->ip_ttl = 64;
+	iph->ip_src = _source.in_addr();
+
+	click_udp* udpHeader = (click_udp*) (iph + 1);
+	udpHeader->uh_sport = htons(1234);
+	udpHeader->uh_dport = htons(1234);
+	udpHeader->uh_ulen = htons(_length - sizeof(click_ether) - sizeof(click_ip));
+	udpHeader->uh_sum = 0;
+
+	// Sum of the header without its destination, the destination is added per packet
+	iph->ip_sum = 0;
+	_partialSum = (~click_in_cksum((unsigned char*) iph, sizeof(click_ip))) & 0xFFFF;
+}
+
+bool CorrespondentSource::run_task(Task*){
+	if (!_active)
+		return false;
+	_tokens.refill();
+	unsigned count = _burst;
+	if (_tokens.size() < count)
+		count = _tokens.size();
+	if (count == 0) {
+		_timer.schedule_after(Timestamp::make_jiffies(_tokens.time_until_contains(_burst)));
+		return false;
+	}
+	_tokens.remove(count);
+
+	// One timestamp per burst, like a receive batch of a device
+	Timestamp now = Timestamp::now();
+	uint32_t first = ntohl(_destination.addr());
+	for (unsigned i = 0; i < count; i++) {
+		WritablePacket* p = Packet::make(_template, _length);
+		if (!p)
+			break;
+		click_ip* iph = (click_ip*) (p->data() + sizeof(click_ether));
+		uint32_t destination = htonl(first + _next);
+		iph->ip_dst.s_addr = destination;
+		uint32_t sum = _partialSum + (destination & 0xFFFF) + (destination >> 16);
+		sum = (sum & 0xFFFF) + (sum >> 16);
+		sum = (sum & 0xFFFF) + (sum >> 16);
+		iph->ip_sum = ~sum & 0xFFFF;
+		if (++_next == _destinations)
+			_next = 0;
+		p->timestamp_anno() = now;
+		output(0).push(p);
+		_count++;
+	}
+	_task.fast_reschedule();
+	return true;
+}
+
+enum { H_COUNT, H_ACTIVE, H_RATE, H_LENGTH, H_DESTINATIONS, H_RESET };
+
+String CorrespondentSource::read_handler(Element* e, void* thunk){
+	CorrespondentSource* source = (CorrespondentSource*) e;
+	switch ((intptr_t) thunk) {
+		case H_COUNT:
+			return String(source->_count);
+		case H_ACTIVE:
+			return String(source->_active);
+		case H_RATE:
+			return String(source->_rate);
+		case H_LENGTH:
+			return String(source->_length);
+		case H_DESTINATIONS:
+			return String(source->_destinations);
+		default:
+			return String();
+	}
+}
+
+int CorrespondentSource::write_handler(const String& input, Element* e, void* thunk, ErrorHandler* errh){
+	CorrespondentSource* source = (CorrespondentSource*) e;
+	unsigned value;
+	switch ((intptr_t) thunk) {
+		case H_ACTIVE:
+			if (!cp_bool(input, &source->_active))
+				return errh->error("active must be a boolean");
+			if (source->_active)
+				source->_task.reschedule();
+			return 0;
+		case H_RATE:
+			if (!cp_integer(input, &value))
+				return errh->error("rate must be an integer");
+			source->_setRate(value);
+			return 0;
+		case H_LENGTH:
+			if (!cp_integer(input, &value) || value < MIN_LENGTH || value > MAX_LENGTH)
+				return errh->error("length must be between %d and %d", MIN_LENGTH, MAX_LENGTH);
+			source->_length = value;
+			source->_buildTemplate();
+			return 0;
+		case H_DESTINATIONS:
+			if (!cp_integer(input, &value) || value < 1)
+				return errh->error("destinations must be at least 1");
+			source->_destinations = value;
+			source->_next = 0;
+			return 0;
+		case H_RESET:
+			source->_count = 0;
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void CorrespondentSource::add_handlers(){
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("active", read_handler, H_ACTIVE);
+	add_write_handler("active", write_handler, H_ACTIVE);
+	add_read_handler("rate", read_handler, H_RATE);
+	add_write_handler("rate", write_handler, H_RATE);
+	add_read_handler("length", read_handler, H_LENGTH);
+	add_write_handler("length", write_handler, H_LENGTH);
+	add_read_handler("destinations", read_handler, H_DESTINATIONS);
+	add_write_handler("destinations", write_handler, H_DESTINATIONS);
+	add_write_handler("reset", write_handler, H_RESET, Handler::BUTTON);
+	add_task_handlers(&_task);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(CorrespondentSource)
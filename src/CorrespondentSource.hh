@@ -0,0 +1,82 @@
+#ifndef CLICK_CORRESPONDENTSOURCE_HH
+#define CLICK_CORRESPONDENTSOURCE_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/task.hh>
+#include <click/tokenbucket.hh>
+#include <click/etheraddress.hh>
+
+CLICK_DECLS
+
+/*
+ *	Click element that emulates a correspondent node sending UDP traffic to a set of
+ *	mobile nodes, like FastUDPSource but with DESTINATIONS destination addresses
+ *	It is a load generator for the tunnel benchmarks (see benchmarks/tunnel_stress.click)
+ *	- packet i goes to DST + (i % DESTINATIONS), from SRC port 1234 to port 1234
+ *	- LENGTH is the length of the Ethernet frame (60 to 1514 bytes), the UDP checksum is 0
+ *	- every packet is a fresh copy of a template, only the destination and IP checksum change
+ *	- packets are sent in bursts of BURST, at RATE packets per second or as fast as the
+ *	  downstream elements take them (RATE 0)
+ *	- the packets of a burst carry the time the burst was sent in their timestamp annotation
+ *	Output 0 ==> the Ethernet frames
+ *	Read handlers:
+ *	- count ==> packets sent
+ *	- active, rate, length, destinations ==> current settings
+ *	Write handlers:
+ *	- active ==> start (true) or pause (false) sending
+ *	- rate, length, destinations ==> change the traffic, also while sending
+ *	- reset ==> reset count
+*/
+class CorrespondentSource : public Element {
+	public:
+		CorrespondentSource();
+		~CorrespondentSource();
+
+		const char *class_name() const	{ return "CorrespondentSource"; }
+		const char *port_count() const	{ return PORTS_0_1; }
+		const char *processing() const	{ return PUSH; }
+		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
+		bool run_task(Task*);
+		void add_handlers();
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		// Task which sends the bursts
+		Task _task;
+
+		// Wakes the task up when the tokens for the next burst are due (RATE)
+		Timer _timer;
+
+		// Limits the packet rate to RATE
+		TokenBucket _tokens;
+
+		IPAddress _source;
+		IPAddress _destination;
+		EtherAddress _sourceEther;
+		EtherAddress _destinationEther;
+		uint32_t _destinations;
+		unsigned _length;
+		unsigned _rate;
+		unsigned _burst;
+		bool _active;
+
+		// Frame with destination DST and the IP checksum without the destination
+		unsigned char _template[1514];
+		uint32_t _partialSum;
+
+		// Index of the destination of the next packet
+		uint32_t _next;
+
+		uint64_t _count;
+
+		// Rebuild the template after a change of LENGTH
+		void _buildTemplate();
+
+		void _setRate(unsigned rate);
+};
+
+CLICK_ENDDECLS
+#endif
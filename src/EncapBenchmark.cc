@@ -0,0 +1,173 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/timestamp.hh>
+#include <clicknet/ip.h>
+
+// Local imports
+#include "EncapBenchmark.hh"
+#include "utils/HelperFunctions.hh"
+
+// Packets in the buffer of the benchmark
+#define ENCAP_PACKETS 64
+
+CLICK_DECLS
+EncapBenchmark::EncapBenchmark(): _iterations(10000000), _length(64), _identical(false), _sink(0){
+	memset(_results, 0, sizeof(_results));
+}
+
+EncapBenchmark::~ EncapBenchmark(){}
+
+int EncapBenchmark::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"ITERATIONS", cpkN, cpUnsigned, &_iterations, \
+		"LENGTH", cpkN, cpUnsigned, &_length, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_iterations < ENCAP_PACKETS)
+		return errh->error("ITERATIONS must be at least %d", ENCAP_PACKETS);
+	if (_length < sizeof(click_ip) || _length > 0xFFFF - sizeof(click_ip))
+		return errh->error("LENGTH must be between %d and %d", (int) sizeof(click_ip), 0xFFFF - (int) sizeof(click_ip));
+	return 0;
+}
+
+WritablePacket* EncapBenchmark::_makePacket(uint32_t i){
+	WritablePacket* p = Packet::make(sizeof(click_ip), 0, _length, 0);
+	if (!p)
+		return 0;
+	memset(p->data(), 0, _length);
+	click_ip* iph = (click_ip *) p->data();
+	iph->ip_v = 4;
+	iph->ip_hl = sizeof(click_ip) >> 2;
+	iph->ip_tos = i & 0xFC;
+	iph->ip_len = htons(_length);
+	iph->ip_id = htons(i);
+	// The forwarding path already decremented the TTL
+	iph->ip_ttl = 63;
+	iph->ip_p = IP_PROTO_UDP;
+	iph->ip_src = IPAddress(htonl(0x0A000000 + i)).in_addr();
+	iph->ip_dst = IPAddress(htonl(0xC0A80000 + i)).in_addr();
+	iph->ip_sum = click_in_cksum((unsigned char *)iph, sizeof(click_ip));
+	p->set_ip_header(iph, sizeof(click_ip));
+	return p;
+}
+
+template <int WAY>
+WritablePacket* EncapBenchmark::_encap(Packet* p, const MobilityBinding& binding){
+	if (WAY == WAY_TEMPLATE)
+		return encapIPinIP(p, binding);
+	// Before the bindings cached their tunnel header: both checksums are computed in full
+	click_ip* innerIP = (click_ip *) p->data();
+	innerIP->ip_ttl++;
+	innerIP->ip_sum = 0;
+	innerIP->ip_sum = click_in_cksum((unsigned char *)innerIP, sizeof(click_ip));
+	p->set_ip_header(innerIP, sizeof(click_ip));
+	WritablePacket* newPacket = p->push(sizeof(click_ip));
+	if (!newPacket)
+		return 0;
+	click_ip* outerIP = reinterpret_cast<click_ip *>(newPacket->data());
+	innerIP = reinterpret_cast<click_ip *>(newPacket->data() + sizeof(click_ip));
+	outerIP->ip_v = 4;
+	outerIP->ip_hl = sizeof(click_ip) >> 2;
+	outerIP->ip_p = 4;
+	outerIP->ip_off = 0;
+	outerIP->ip_id = 0;
+	outerIP->ip_tos = innerIP->ip_tos;
+	outerIP->ip_len = htons(newPacket->length());
+	outerIP->ip_ttl = 64;
+	outerIP->ip_src = binding.tunnelHeader.ip_src;
+	outerIP->ip_dst = IPAddress(binding.careOfAddress).in_addr();
+	outerIP->ip_sum = 0;
+	outerIP->ip_sum = click_in_cksum((unsigned char *)outerIP, sizeof(click_ip));
+	newPacket->set_dst_ip_anno(IPAddress(outerIP->ip_dst));
+	newPacket->set_ip_header(outerIP, sizeof(click_ip));
+	return newPacket;
+}
+
+template <int WAY>
+void EncapBenchmark::_measure(const MobilityBinding& binding){
+	Packet* packets[ENCAP_PACKETS];
+	for (int i = 0; i < ENCAP_PACKETS; i++)
+		packets[i] = _makePacket(i);
+	uint64_t sum = 0;
+	Timestamp start = Timestamp::now_steady();
+	for (uint32_t i = 0; i < _iterations; i++) {
+		Packet*& p = packets[i % ENCAP_PACKETS];
+		if (WritablePacket* q = _encap<WAY>(p, binding)) {
+			sum += q->ip_header()->ip_sum;
+			// Decapsulate for the next turn, the packet is not shared so push and pull stay in place
+			q->pull(sizeof(click_ip));
+			p = q;
+		} else {
+			p = _makePacket(i);
+		}
+	}
+	_results[WAY] = (double) (Timestamp::now_steady() - start).nsecval() / _iterations;
+	_sink += sum;
+	for (int i = 0; i < ENCAP_PACKETS; i++)
+		if (packets[i])
+			packets[i]->kill();
+}
+
+bool EncapBenchmark::_compare(const MobilityBinding& binding){
+	WritablePacket* full = _encap<WAY_FULL>(_makePacket(0x1234), binding);
+	WritablePacket* tunnel = _encap<WAY_TEMPLATE>(_makePacket(0x1234), binding);
+	bool identical = full && tunnel && full->length() == tunnel->length()
+		&& memcmp(full->data(), tunnel->data(), full->length()) == 0
+		&& full->dst_ip_anno() == tunnel->dst_ip_anno();
+	if (full)
+		full->kill();
+	if (tunnel)
+		tunnel->kill();
+	return identical;
+}
+
+void EncapBenchmark::_run(){
+	MobilityBinding binding = MobilityBinding();
+	binding.homeAddress = htonl(0xC0A80001);
+	binding.careOfAddress = htonl(0xC0A80101);
+	buildTunnelHeader(binding, IPAddress(htonl(0xC0A801FE)));
+	_measure<WAY_FULL>(binding);
+	_measure<WAY_TEMPLATE>(binding);
+	_identical = _compare(binding);
+}
+
+enum { H_IDENTICAL, H_RUN, H_NS, H_MPPS = H_NS + EncapBenchmark::WAYS };
+static const char* const wayNames[] = { "full", "template" };
+
+String EncapBenchmark::read_handler(Element* e, void* thunk){
+	EncapBenchmark* benchmark = (EncapBenchmark*) e;
+	intptr_t which = (intptr_t) thunk;
+	if (which == H_IDENTICAL)
+		return String(benchmark->_identical);
+	if (which >= H_MPPS) {
+		double ns = benchmark->_results[which - H_MPPS];
+		return String(ns > 0 ? 1000 / ns : 0);
+	}
+	return String(benchmark->_results[which - H_NS]);
+}
+
+int EncapBenchmark::write_handler(const String&, Element* e, void* thunk, ErrorHandler*){
+	EncapBenchmark* benchmark = (EncapBenchmark*) e;
+	switch ((intptr_t) thunk) {
+		case H_RUN:
+			benchmark->_run();
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void EncapBenchmark::add_handlers(){
+	for (int way = 0; way < WAYS; way++) {
+		add_read_handler(String(wayNames[way]) + "_ns", read_handler, H_NS + way);
+		add_read_handler(String(wayNames[way]) + "_mpps", read_handler, H_MPPS + way);
+	}
+	add_read_handler("identical", read_handler, H_IDENTICAL);
+	add_write_handler("run", write_handler, H_RUN, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(EncapBenchmark)
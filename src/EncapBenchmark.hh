@@ -0,0 +1,70 @@
+#ifndef CLICK_ENCAPBENCHMARK_HH
+#define CLICK_ENCAPBENCHMARK_HH
+#include <click/element.hh>
+
+// Local imports
+#include "structs/MobilityBinding.hh"
+
+CLICK_DECLS
+
+/*
+ *	Click element that measures the cost of the IP in IP encapsulation of the home agent
+ *	on one core, with the outer header built per packet against the template of the binding
+ *	- the full way builds the outer header field by field and checksums both headers,
+ *	  as RoutingElement did before the bindings cached their tunnel header
+ *	- the template way is encapIPinIP() of utils/HelperFunctions.hh
+ *	- the run handler encapsulates ITERATIONS packets both ways, spread over a buffer
+ *	  of 64 packets of LENGTH bytes; every packet is decapsulated again after its turn
+ *	- it also checks that both ways build the same bytes
+ *	No ports, use it from a Script (see benchmarks/encap.click)
+ *	Read handlers (after run):
+ *	- <way>_ns ==> nanoseconds per encapsulated packet
+ *	- <way>_mpps ==> million encapsulated packets per second on one core
+ *	  way: full, template
+ *	- identical ==> true if both ways build the same bytes
+ *	Write handlers:
+ *	- run ==> run the benchmark
+*/
+class EncapBenchmark : public Element {
+	public:
+		EncapBenchmark();
+		~EncapBenchmark();
+
+		const char *class_name() const	{ return "EncapBenchmark"; }
+		const char *port_count() const	{ return PORTS_0_0; }
+		int configure(Vector<String>&, ErrorHandler*);
+		void add_handlers();
+
+		enum { WAY_FULL, WAY_TEMPLATE, WAYS };
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		unsigned _iterations;
+		unsigned _length;
+
+		// Nanoseconds per packet of every way
+		double _results[WAYS];
+		bool _identical;
+
+		// Sum of the outer checksums, keeps the compiler from dropping the loops
+		uint64_t _sink;
+
+		// A packet of _length bytes with an inner IP header and room for the outer one
+		WritablePacket* _makePacket(uint32_t i);
+
+		// Encapsulate p the given way, returns the encapsulated packet or 0
+		template <int WAY> static inline __attribute__((always_inline)) WritablePacket* _encap(Packet* p, const MobilityBinding& binding);
+
+		// Time ITERATIONS encapsulations of one way
+		template <int WAY> void _measure(const MobilityBinding& binding);
+
+		// True if both ways build the same bytes
+		bool _compare(const MobilityBinding& binding);
+
+		void _run();
+};
+
+CLICK_ENDDECLS
+#endif
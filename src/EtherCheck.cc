@@ -44,8 +44,10 @@ void EtherCheck::push(int, Packet* p){
 				q->pull(sizeof(click_ether));
 				q->push(sizeof(click_ether));
 				click_ether* newEtherHeader = (click_ether*) q->data();
+				// Prefer the current agent of the Monitor, the latest advertisement may be another one
+				const uint8_t* agentEther = _monitorMN->agentEtherAddress();
 				for (int i=0; i<6; i++)
-					newEtherHeader->ether_dhost[i] = etherDest[i];
+					newEtherHeader->ether_dhost[i] = agentEther ? agentEther[i] : etherDest[i];
 				for (int i=0; i<6; i++)
 					newEtherHeader->ether_shost[i] = eth_h->ether_shost[i];
 				newEtherHeader->ether_type = eth_h->ether_type;
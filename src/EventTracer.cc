@@ -0,0 +1,153 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include <algorithm>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+
+// Local imports
+#include "EventTracer.hh"
+#include "utils/EventTrace.hh"
+
+#define CRASH_FILE_LENGTH 1024
+
+CLICK_DECLS
+
+// State of the crash handler, a signal handler cannot use the element safely
+static const int crashSignals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+static const int nCrashSignals = sizeof(crashSignals) / sizeof(crashSignals[0]);
+static struct sigaction previousActions[nCrashSignals];
+static char crashFile[CRASH_FILE_LENGTH];
+static const char* crashNames = 0;
+static uint32_t crashNamesLength = 0;
+static const EventTracer* crashTracer = 0;
+
+static void crashHandler(int signal){
+	int fd = open(crashFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd >= 0) {
+		EventTrace::instance().dump(fd, crashNames, crashNamesLength);
+		close(fd);
+	}
+	// SA_RESETHAND restored the default action, die of the signal
+	raise(signal);
+}
+
+EventTracer::EventTracer(): _file("eventtrace.dump"), _crash(false){}
+
+EventTracer::~ EventTracer(){}
+
+int EventTracer::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"FILE", cpkN, cpFilename, &_file, \
+		"CRASH", cpkN, cpBool, &_crash, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_crash && _file.length() >= CRASH_FILE_LENGTH)
+		return errh->error("FILE is too long for a crash dump");
+	return 0;
+}
+
+int EventTracer::initialize(ErrorHandler *errh) {
+	StringAccum sa;
+	for (int i = 0; i < router()->nelements(); i++)
+		sa << i << ' ' << router()->element(i)->name() << '\n';
+	_names = sa.take_string();
+
+	if (_crash) {
+		// The rings are allocated on first use, not in the signal handler
+		EventTrace::instance();
+		if (crashTracer)
+			return errh->error("%s already dumps the event trace on a crash", crashTracer->name().c_str());
+		memcpy(crashFile, _file.c_str(), _file.length() + 1);
+		crashNames = _names.data();
+		crashNamesLength = _names.length();
+		crashTracer = this;
+
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = crashHandler;
+		action.sa_flags = SA_RESETHAND;
+		sigemptyset(&action.sa_mask);
+		for (int i = 0; i < nCrashSignals; i++)
+			sigaction(crashSignals[i], &action, &previousActions[i]);
+	}
+	return 0;
+}
+
+void EventTracer::cleanup(CleanupStage) {
+	if (crashTracer == this) {
+		for (int i = 0; i < nCrashSignals; i++)
+			sigaction(crashSignals[i], &previousActions[i], 0);
+		crashTracer = 0;
+	}
+}
+
+static bool recordLess(const TraceRecord& a, const TraceRecord& b){
+	return a.time < b.time;
+}
+
+String EventTracer::_events() const {
+	Vector<TraceRecord> records;
+	EventTrace::instance().snapshot(records);
+	std::stable_sort(records.begin(), records.end(), recordLess);
+
+	StringAccum sa;
+	for (int i = 0; i < records.size(); i++) {
+		const TraceRecord& r = records[i];
+		String element = r.element < router()->nelements() ? router()->element(r.element)->name() : String(r.element);
+		sa << Timestamp::make_nsec(r.time / 1000000000, r.time % 1000000000) << ' ' << r.thread << ' '
+			<< element << ' ' << traceEventName(r.type) << ' '
+			<< IPAddress(r.address) << ' ' << IPAddress(r.peer) << ' ' << r.identification << ' ' << r.value << '\n';
+	}
+	return sa.take_string();
+}
+
+int EventTracer::_dump(const String& file, ErrorHandler* errh) const {
+	int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return errh->error("%s: %s", file.c_str(), strerror(errno));
+	bool written = EventTrace::instance().dump(fd, _names.data(), _names.length());
+	close(fd);
+	if (!written)
+		return errh->error("%s: write failed", file.c_str());
+	return 0;
+}
+
+enum { H_EVENTS, H_COUNT, H_DUMP };
+
+String EventTracer::read_handler(Element* e, void* thunk){
+	EventTracer* tracer = (EventTracer*) e;
+	switch ((intptr_t) thunk) {
+		case H_EVENTS:
+			return tracer->_events();
+		case H_COUNT:
+			return String(EventTrace::instance().count());
+		default:
+			return String();
+	}
+}
+
+int EventTracer::write_handler(const String& input, Element* e, void* thunk, ErrorHandler* errh){
+	EventTracer* tracer = (EventTracer*) e;
+	String file = cp_uncomment(input);
+	switch ((intptr_t) thunk) {
+		case H_DUMP:
+			return tracer->_dump(file ? file : tracer->_file, errh);
+		default:
+			return -1;
+	}
+}
+
+void EventTracer::add_handlers(){
+	add_read_handler("events", read_handler, H_EVENTS);
+	add_read_handler("count", read_handler, H_COUNT);
+	add_write_handler("dump", write_handler, H_DUMP, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(EventTracer)
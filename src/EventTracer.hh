@@ -0,0 +1,51 @@
+#ifndef CLICK_EVENTTRACER_HH
+#define CLICK_EVENTTRACER_HH
+#include <click/element.hh>
+
+CLICK_DECLS
+
+/*
+ *	Click element that reads and dumps the event trace of the process (see utils/EventTrace.hh)
+ *	The agent and mobile node elements record their state transitions (advertisements,
+ *	registrations, bindings, visitors, handovers) in per-thread rings, with or without an
+ *	EventTracer, this element makes the rings readable
+ *	- a dump is binary (see structs/TraceRecord.hh), decode it with tools/trace_decode.cc
+ *	- with CRASH true a fatal signal (SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT) dumps the
+ *	  rings to FILE before the process dies, only one EventTracer can have CRASH true
+ *	No ports
+ *	Read handlers:
+ *	- events ==> the events in the rings, oldest first, one per line:
+ *	  <time> <thread> <element> <event> <address> <peer> <identification> <value>
+ *	- count ==> events recorded since the start, also those the rings no longer hold
+ *	Write handlers:
+ *	- dump ==> write a dump to the file given as argument, or to FILE
+*/
+class EventTracer : public Element {
+	public:
+		EventTracer();
+		~EventTracer();
+
+		const char *class_name() const	{ return "EventTracer"; }
+		const char *port_count() const	{ return PORTS_0_0; }
+		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
+		void cleanup(CleanupStage);
+		void add_handlers();
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		// Default file of the dump handler and file of the crash dump
+		String _file;
+		bool _crash;
+
+		// Element names of the dumps, "<index> <name>\n" per element of the router
+		String _names;
+
+		String _events() const;
+		int _dump(const String& file, ErrorHandler* errh) const;
+};
+
+CLICK_ENDDECLS
+#endif
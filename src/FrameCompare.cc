@@ -0,0 +1,161 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+
+// Local imports
+#include "FrameCompare.hh"
+
+CLICK_DECLS
+FrameCompare::FrameCompare(): _ignoreIPID(false), _ignoreChecksums(false), _expected(0), _produced(0){}
+
+FrameCompare::~ FrameCompare(){}
+
+int FrameCompare::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"IGNORE_IP_ID", cpkN, cpBool, &_ignoreIPID, \
+		"IGNORE_CHECKSUMS", cpkN, cpBool, &_ignoreChecksums, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	return 0;
+}
+
+void FrameCompare::cleanup(CleanupStage){
+	_clear();
+}
+
+uint64_t FrameCompare::_hash(Packet* p) const {
+	const unsigned char* data = p->data();
+	unsigned length = p->length();
+	// Byte ranges left out of the hash, at most the IP identification, the IP and the UDP checksum
+	unsigned from[3], to[3];
+	int ranges = 0;
+	if (length >= sizeof(click_ether) + sizeof(click_ip) && data[12] == 0x08 && data[13] == 0x00) {
+		const click_ip* iph = (const click_ip*) (data + sizeof(click_ether));
+		unsigned ip = sizeof(click_ether);
+		unsigned udp = ip + (iph->ip_hl << 2);
+		if (_ignoreIPID) {
+			from[ranges] = ip + offsetof(click_ip, ip_id);
+			to[ranges++] = ip + offsetof(click_ip, ip_id) + 2;
+		}
+		if (_ignoreChecksums) {
+			from[ranges] = ip + offsetof(click_ip, ip_sum);
+			to[ranges++] = ip + offsetof(click_ip, ip_sum) + 2;
+			if (iph->ip_p == IP_PROTO_UDP && length >= udp + sizeof(click_udp)) {
+				from[ranges] = udp + offsetof(click_udp, uh_sum);
+				to[ranges++] = udp + offsetof(click_udp, uh_sum) + 2;
+			}
+		}
+	}
+	// FNV-1a, the ignored bytes count as zero
+	uint64_t hash = 0xcbf29ce484222325ULL ^ length;
+	for (unsigned i = 0; i < length; i++) {
+		unsigned char byte = data[i];
+		for (int range = 0; range < ranges; range++)
+			if (i >= from[range] && i < to[range])
+				byte = 0;
+		hash = (hash ^ byte) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+void FrameCompare::push(int port, Packet* p){
+	if (port == 0)
+		_expected++;
+	else
+		_produced++;
+	HashTable<uint64_t, Frame>::iterator it = _frames.find_insert(_hash(p), Frame());
+	Frame& frame = it.value();
+	frame.balance += port == 0 ? 1 : -1;
+	if (!frame.example)
+		frame.example = p;
+	else
+		p->kill();
+}
+
+uint64_t FrameCompare::_unmatched(int sign, Packet** example) const {
+	uint64_t count = 0;
+	*example = 0;
+	for (HashTable<uint64_t, Frame>::const_iterator it = _frames.begin(); it != _frames.end(); ++it) {
+		int64_t balance = it.value().balance * sign;
+		if (balance > 0) {
+			count += balance;
+			if (!*example)
+				*example = it.value().example;
+		}
+	}
+	return count;
+}
+
+void FrameCompare::_clear(){
+	for (HashTable<uint64_t, Frame>::iterator it = _frames.begin(); it != _frames.end(); ++it)
+		it.value().example->kill();
+	_frames.clear();
+	_expected = _produced = 0;
+}
+
+enum { H_EXPECTED, H_PRODUCED, H_MATCHED, H_MISSING, H_UNEXPECTED, H_RESULT, H_MISSING_EXAMPLE, H_UNEXPECTED_EXAMPLE, H_RESET };
+
+String FrameCompare::read_handler(Element* e, void* thunk){
+	FrameCompare* compare = (FrameCompare*) e;
+	Packet* example;
+	switch ((intptr_t) thunk) {
+		case H_EXPECTED:
+			return String(compare->_expected);
+		case H_PRODUCED:
+			return String(compare->_produced);
+		case H_MATCHED:
+			return String(compare->_produced - compare->_unmatched(-1, &example));
+		case H_MISSING:
+			return String(compare->_unmatched(1, &example));
+		case H_UNEXPECTED:
+			return String(compare->_unmatched(-1, &example));
+		case H_RESULT:
+			if (compare->_unmatched(1, &example) || compare->_unmatched(-1, &example))
+				return String("MISMATCH");
+			return String("MATCH");
+		case H_MISSING_EXAMPLE:
+		case H_UNEXPECTED_EXAMPLE: {
+			compare->_unmatched((intptr_t) thunk == H_MISSING_EXAMPLE ? 1 : -1, &example);
+			if (!example)
+				return String("-");
+			StringAccum sa;
+			for (unsigned i = 0; i < example->length(); i++)
+				sa.snprintf(3, "%02x", example->data()[i]);
+			return sa.take_string();
+		}
+		default:
+			return String();
+	}
+}
+
+int FrameCompare::write_handler(const String&, Element* e, void* thunk, ErrorHandler*){
+	FrameCompare* compare = (FrameCompare*) e;
+	switch ((intptr_t) thunk) {
+		case H_RESET:
+			compare->_clear();
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void FrameCompare::add_handlers(){
+	add_read_handler("expected", read_handler, H_EXPECTED);
+	add_read_handler("produced", read_handler, H_PRODUCED);
+	add_read_handler("matched", read_handler, H_MATCHED);
+	add_read_handler("missing", read_handler, H_MISSING);
+	add_read_handler("unexpected", read_handler, H_UNEXPECTED);
+	add_read_handler("result", read_handler, H_RESULT);
+	add_read_handler("missing_example", read_handler, H_MISSING_EXAMPLE);
+	add_read_handler("unexpected_example", read_handler, H_UNEXPECTED_EXAMPLE);
+	add_write_handler("reset", write_handler, H_RESET, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(FrameCompare)
@@ -0,0 +1,70 @@
+#ifndef CLICK_FRAMECOMPARE_HH
+#define CLICK_FRAMECOMPARE_HH
+#include <click/element.hh>
+#include <click/hashtable.hh>
+
+CLICK_DECLS
+
+/*
+ *	Click element that compares the contents of the Ethernet frames an entity sends with
+ *	the frames it sent in a capture (see benchmarks/pcap_replay.click)
+ *	- every frame is reduced to a 64-bit hash of its bytes and its length
+ *	- the comparison is on the multiset of frames: the order does not matter, every
+ *	  expected frame must be produced as many times as it was expected
+ *	- IGNORE_IP_ID true leaves the identification of the (outer) IP header out of the hash
+ *	- IGNORE_CHECKSUMS true leaves the (outer) IP checksum and the UDP checksum out of the hash,
+ *	  a capture may carry no UDP checksum where the agents set one
+ *	- one frame of every distinct hash is kept as an example
+ *	Input 0 ==> expected frames
+ *	Input 1 ==> produced frames
+ *	Read handlers:
+ *	- expected, produced ==> frames received on every input
+ *	- matched ==> produced frames that matched an expected frame
+ *	- missing ==> expected frames that were not produced
+ *	- unexpected ==> produced frames that were not expected
+ *	- result ==> MATCH if no frame is missing or unexpected, MISMATCH otherwise
+ *	- missing_example, unexpected_example ==> one missing or unexpected frame in hex
+ *	Write handlers:
+ *	- reset ==> forget all frames
+*/
+class FrameCompare : public Element {
+	public:
+		FrameCompare();
+		~FrameCompare();
+
+		const char *class_name() const	{ return "FrameCompare"; }
+		const char *port_count() const	{ return "2/0"; }
+		const char *processing() const	{ return PUSH; }
+		int configure(Vector<String>&, ErrorHandler*);
+		void cleanup(CleanupStage);
+		void push(int, Packet* p);
+		void add_handlers();
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		struct Frame {
+			// Expected minus produced frames with this hash
+			int64_t balance;
+			Packet* example;
+		};
+
+		bool _ignoreIPID;
+		bool _ignoreChecksums;
+
+		HashTable<uint64_t, Frame> _frames;
+		uint64_t _expected;
+		uint64_t _produced;
+
+		// Hash of the frame without the ignored fields
+		uint64_t _hash(Packet* p) const;
+
+		// Missing (sign 1) or unexpected (sign -1) frames, and one of them as example
+		uint64_t _unmatched(int sign, Packet** example) const;
+
+		void _clear();
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,92 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include <algorithm>
+
+// Local imports
+#include "MetricsExporter.hh"
+#include "utils/Metrics.hh"
+
+CLICK_DECLS
+MetricsExporter::MetricsExporter(): _all(false){}
+
+MetricsExporter::~ MetricsExporter(){}
+
+int MetricsExporter::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"ALL", cpkN, cpBool, &_all, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	return 0;
+}
+
+// Name of the metric of a sample, up to its labels
+static String metricName(const String& line){
+	int labels = line.find_left('{');
+	return labels < 0 ? line : line.substring(0, labels);
+}
+
+static bool metricLess(const String& a, const String& b){
+	return metricName(a) < metricName(b);
+}
+
+String MetricsExporter::_metrics() const {
+	// Elements of the same compound element share the prefix of this element
+	String prefix = name().substring(0, name().find_right('/') + 1);
+	StringAccum samples;
+	for (int i = 0; i < router()->nelements(); i++) {
+		Element* e = router()->element(i);
+		if (!_all && !e->name().starts_with(prefix))
+			continue;
+		if (MetricsSource* source = (MetricsSource*) e->cast("MetricsSource"))
+			source->writeMetrics(samples);
+	}
+
+	// The text format wants the samples of a metric together, keep the element order within
+	Vector<String> lines;
+	String all = samples.take_string();
+	for (int start = 0; start < all.length(); ) {
+		int end = all.find_left('\n', start);
+		if (end < 0)
+			end = all.length();
+		lines.push_back(all.substring(start, end - start));
+		start = end + 1;
+	}
+	std::stable_sort(lines.begin(), lines.end(), metricLess);
+
+	StringAccum sa;
+	String current;
+	for (int i = 0; i < lines.size(); i++) {
+		String metric = metricName(lines[i]);
+		if (metric != current) {
+			bool counter = metric.length() > 6 && metric.substring(metric.length() - 6) == "_total";
+			sa << "# TYPE " << metric << (counter ? " counter" : " gauge") << '\n';
+			current = metric;
+		}
+		sa << lines[i] << '\n';
+	}
+	return sa.take_string();
+}
+
+enum { H_METRICS };
+
+String MetricsExporter::read_handler(Element* e, void* thunk){
+	MetricsExporter* exporter = (MetricsExporter*) e;
+	switch ((intptr_t) thunk) {
+		case H_METRICS:
+			return exporter->_metrics();
+		default:
+			return String();
+	}
+}
+
+void MetricsExporter::add_handlers(){
+	add_read_handler("metrics", read_handler, H_METRICS);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(MetricsExporter)
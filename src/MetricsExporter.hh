@@ -0,0 +1,39 @@
+#ifndef CLICK_METRICSEXPORTER_HH
+#define CLICK_METRICSEXPORTER_HH
+#include <click/element.hh>
+
+CLICK_DECLS
+
+/*
+ *	Click element that serves the counters of the agent and mobile node elements
+ *	in the Prometheus text format, so one handler read scrapes a whole agent
+ *	- it exports every element that is a MetricsSource (see utils/Metrics.hh) in the
+ *	  same compound element as itself, or in the whole router with ALL true
+ *	- the samples of a metric are grouped under one # TYPE line
+ *	No ports, read it through a ControlSocket (click -p <port>):
+ *	  READ <agent>/metrics.metrics
+ *	Read handlers:
+ *	- metrics ==> the current value of every exported metric
+*/
+class MetricsExporter : public Element {
+	public:
+		MetricsExporter();
+		~MetricsExporter();
+
+		const char *class_name() const	{ return "MetricsExporter"; }
+		const char *port_count() const	{ return PORTS_0_0; }
+		int configure(Vector<String>&, ErrorHandler*);
+		void add_handlers();
+
+	private:
+		static String read_handler(Element*, void*);
+
+		// Export the metrics of the whole router instead of the compound element
+		bool _all;
+
+		// Collect and format the metrics of the exported elements
+		String _metrics() const;
+};
+
+CLICK_ENDDECLS
+#endif
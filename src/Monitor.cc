@@ -1,52 +1,193 @@
 #include <click/config.h>
 #include <click/confparse.hh>
 #include <click/error.hh>
+#include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include <clicknet/udp.h>
 #include <clicknet/ip.h>
 
 // Local imports
 #include "Monitor.hh"
-#include "structs/RegistrationReply.hh"
-#include "structs/ICMPAdvertisement.hh"
-#include "structs/MobilityAgentAdvertisementExtension.hh"
+#include "structs/WireViews.hh"
 #include "utils/Configurables.hh"
+#include "utils/EventTrace.hh"
 #include "utils/HelperFunctions.hh"
 
+// Agents answer a solicitation within MAX_RESPONSE_DELAY seconds (RFC 1256)
+#define MAX_RESPONSE_DELAY 2
+
+// Counters of the mobile node, replies are counted per code
+enum { C_ADVERTISEMENTS, C_ADVERTISEMENTS_INVALID, C_DATA_PACKETS, C_HANDOVERS, C_AGENTS_LOST, C_FAILOVERS,
+       C_REPLIES, C_END = C_REPLIES + 256 };
+
 CLICK_DECLS
-Monitor::Monitor() :  _currentSequenceNumber(0), _atHome(true){}
+Monitor::Monitor() :  _currentSequenceNumber(0), _atHome(true), _inHandover(false), _missed(3), _agentTimer(this), _agentLost(false), _lazy(false){}
 
 Monitor::~ Monitor(){}
 
 int Monitor::configure(Vector<String> &conf, ErrorHandler *errh) {
+	int agents = 8;
 	if (cp_va_kparse(conf, this, errh, "SRC", cpkM, cpIPAddress, &_ipAddress,
 	"REQUESTGENERATOR", cpkM, (RequestGenerator*) cpElement, &_reqGenerator,
 	"SOLICITATIONGENERATOR", cpkM, (Solicitor*) cpElement, &_solicitor,
+	"MISSED", cpkN, cpUnsigned, &_missed,
+	"AGENTS", cpkN, cpInteger, &agents,
+	"LAZY", cpkN, cpBool, &_lazy,
 	cpEnd) < 0){
 			return -1;
 	}
+	if (agents < 1)
+		return errh->error("AGENTS must be at least 1");
+	_agents.setCapacity(agents);
+	_counters.initialize(C_END);
 	return 0;
 }
 
+int Monitor::initialize(ErrorHandler *) {
+	_agentTimer.initialize(this);
+	return 0;
+}
+
+void Monitor::run_timer(Timer* t){
+	if (t == &_agentTimer) {
+		// No advertisement of the current agent in time, it is out of reach
+		LOGERROR("[Monitor] Lost agent %s, soliciting a new one", _currentAgent.unparse().c_str());
+		_counters.add(C_AGENTS_LOST);
+		TRACE_EVENT(this, TRACE_AGENT_LOST, _currentAgent.addr(), 0, 0, _advertisementInterval ? _missed : 0);
+		_agents.remove(_currentAgent.addr());
+		_lastAdvertisement = Timestamp();
+		_agentLost = !_failover();
+		// Also look for agents the cache does not know yet
+		_solicitor->startBurst();
+	}
+}
+
+bool Monitor::_failover() {
+	Timestamp now = Timestamp::now_steady();
+	const ICMPRouterEntry* best = _agents.best(now, _currentAgent.addr(), _attached);
+	// Only a fresh advertisement of the home agent means the mobile node is back home
+	if (!best || sameNetwork(IPAddress(best->routerAddress), _ipAddress))
+		return false;
+	ICMPRouterEntry next = *best;
+	IPAddress agent(next.routerAddress);
+	LOGERROR("[Monitor] Failing over to agent %s", agent.unparse().c_str());
+	_counters.add(C_FAILOVERS);
+	// The interval of the advertisements of the new agent is not known yet
+	_lastAdvertisement = Timestamp();
+	_agentTimer.schedule_at_steady(next.expires);
+	_detectHandover(agent);
+	_atHome = false;
+	_reqGenerator->generateRequest(agent, _careOfAddress(next), next.registrationLifetime);
+	return true;
+}
+
+ICMPRouterEntry Monitor::_cacheAgent(Packet* p, IPAddress agent, const ICMPAdvertisement* advertisement,
+				     const MobilityExtensionView& extension, const CareOfWeightsView& weights) {
+	ICMPRouterEntry entry = ICMPRouterEntry();
+	entry.routerAddress = agent.addr();
+	entry.preferenceLevel = (int32_t) ntohl(advertisement->preferenceLevel);
+	entry.sequenceNumber = extension.sequenceNumber();
+	entry.registrationLifetime = extension.registrationLifetime();
+	entry.registrationRequired = (extension.flags() & MobilityExtensionView::FLAG_R) != 0;
+	// Without the weights extension, or with fewer weights than addresses, every address weighs 1
+	for (int i = 0; i < extension.careOfAddresses() && i < MAX_CARE_OF_ADDRESSES; i++) {
+		entry.careOfAddressWeights[entry.careOfAddressCount] = weights.valid() && i < weights.weights() ? weights.weight(i) : 1;
+		entry.careOfAddresses[entry.careOfAddressCount++] = extension.careOfAddress(i).addr();
+	}
+	// The mobile node strips the Ethernet header (mn.click), it is still in front of the IP header
+	const unsigned char* ether = p->network_header() - sizeof(click_ether);
+	if (p->network_header() && ether >= p->buffer())
+		memcpy(entry.etherAddress, ((const click_ether*) ether)->ether_shost, 6);
+	entry.heard = Timestamp::now_steady();
+	entry.expires = entry.heard + Timestamp::make_sec(ntohs(advertisement->lifetime));
+	_agents.update(entry);
+	return entry;
+}
+
+IPAddress Monitor::_careOfAddress(const ICMPRouterEntry& entry) const {
+	return IPAddress(entry.careOfAddresses[careOfAddressIndex(_ipAddress, entry.careOfAddressCount, entry.careOfAddressWeights)]);
+}
+
+const uint8_t* Monitor::agentEtherAddress() const {
+	const ICMPRouterEntry* entry = _agents.find(_currentAgent.addr());
+	return entry ? entry->etherAddress : 0;
+}
+
+void Monitor::_updateAgentDeadline(bool sameAgent, bool solicited, uint16_t lifetime) {
+	Timestamp now = Timestamp::now_steady();
+	if (!sameAgent) {
+		_advertisementInterval = Timestamp();
+		_lastAdvertisement = Timestamp();
+	}
+	if (!solicited) {
+		_advertisementInterval = _lastAdvertisement ? now - _lastAdvertisement : Timestamp();
+		_lastAdvertisement = now;
+	}
+	Timestamp deadline = now + Timestamp::make_sec(lifetime);
+	// An answer to a solicitation is expected within the jittered interval of the solicitor
+	Timestamp expected = _advertisementInterval;
+	if (solicited)
+		expected = Timestamp::make_msec(_solicitor->interval() * 5 / 4) + Timestamp::make_sec(MAX_RESPONSE_DELAY);
+	if (_missed && expected) {
+		Timestamp missed = now + Timestamp::make_usec(expected.usecval() * _missed);
+		if (missed < deadline)
+			deadline = missed;
+	}
+	_agentTimer.schedule_at_steady(deadline);
+}
+
 void Monitor::push(int, Packet* p){
 	const click_ip* iph = p->ip_header();
 	IPAddress destIP = iph->ip_dst;
 
-	// ICMP agent advertisement
-	if (destIP == broadCast) {
+	// ICMP agent advertisement, broadcast or a unicast answer to a solicitation
+	if (destIP == broadCast || (iph->ip_p == IP_PROTO_ICMP && p->length() > sizeof(click_ip) && p->data()[sizeof(click_ip)] == 9)) {
 		_handleAdvertisement(p);
 		return;
 	}
 
 	// Incoming IP packet with UDP payload
 	// MobileIP Registration reply
-	if (destIP == _ipAddress.in_addr() and iph->ip_p == 17) {
+	const click_udp* udpHeader = (const click_udp*) (p->data() + sizeof(click_ip));
+	if (destIP == _ipAddress.in_addr() and iph->ip_p == 17 and ntohs(udpHeader->uh_sport) == 434) {
 		_handleRegistrationReply(p);
 	}
+	else if (destIP == _ipAddress.in_addr()) {
+		// Data packet, it ends a handover once the registration is accepted
+		_lastData = Timestamp::now_steady();
+		_counters.add(C_DATA_PACKETS);
+		if (_inHandover && _handover.reply) {
+			_handover.firstData = _lastData;
+			_handoverData.add((_handover.firstData - _handover.advertisement).usecval());
+			if (_handover.lastData)
+				_handoverGap.add((_handover.firstData - _handover.lastData).usecval());
+			_lastHandover = _handover;
+			_inHandover = false;
+			_counters.add(C_HANDOVERS);
+		}
+	}
 
   	output(0).push(p);
 }
 
+void Monitor::_detectHandover(IPAddress agent) {
+	if (agent == _currentAgent)
+		return;
+	// The first agent the mobile node hears of is not a handover
+	if (_currentAgent) {
+		LOG("[Monitor] Handover to agent %s", agent.unparse().c_str());
+		TRACE_EVENT(this, TRACE_HANDOVER, agent.addr(), _currentAgent.addr(), 0, 0);
+		_inHandover = true;
+		_handover = HandoverTimeline();
+		_handover.agent = agent.addr();
+		_handover.identification = 0;
+		_handover.lastData = _lastData;
+		_handover.advertisement = Timestamp::now_steady();
+	}
+	_currentAgent = agent;
+	_attached = Timestamp::now_steady();
+}
+
 void Monitor::_handleAdvertisement(Packet* p) {
 	const click_ip* iph = p->ip_header();
 	IPAddress srcIP = iph->ip_src;
@@ -60,41 +201,75 @@ void Monitor::_handleAdvertisement(Packet* p) {
 		unsigned csum = click_in_cksum((unsigned char *)icmph, icmp_len) & 0xFFFF;
 		uint8_t numAddrs = advertisement->numAddrs;
 		uint8_t addrEntrySize = advertisement->addrEntrySize;
+		// The mobility agent advertisement extension follows the router addresses, with one or more care of addresses
+		AdvertisementView view(const_cast<unsigned char*>(p->data()), icmp_len);
+		MobilityExtensionView extension = view.valid() ? view.extension() : MobilityExtensionView();
 		if (csum != 0) {
 			LOGERROR("[Monitor] Advertisement message is sent with an invalid checksum");
+			_counters.add(C_ADVERTISEMENTS_INVALID);
 		}
 		else if (advertisement->code != 0) {
 			LOGERROR("[Monitor] Advertisement message is sent with code %d "
 			"but it should be 0", advertisement->code);
+			_counters.add(C_ADVERTISEMENTS_INVALID);
 		}
 		else if (numAddrs < 1) {
 			LOGERROR("[Monitor] Advertisement message is sent with numAddrs = %d "
 			"but it should be greater than or equal to 1", numAddrs);
+			_counters.add(C_ADVERTISEMENTS_INVALID);
 		}
 		else if (addrEntrySize < 2) {
 			LOGERROR("[Monitor] Advertisement message is sent with addrEntrySize = %d "
 			"but it should be greater than or equal to 2", addrEntrySize);
+			_counters.add(C_ADVERTISEMENTS_INVALID);
 		}
 		else if (icmp_len < (unsigned) 8 + (numAddrs * addrEntrySize * 4)) {
 			LOGERROR("[Monitor] Advertisement message is sent with ICMP length = %d "
 			"but it should be greater or equal to %d",
 			icmp_len,
 			8 + (numAddrs * addrEntrySize * 4));
+			_counters.add(C_ADVERTISEMENTS_INVALID);
+		}
+		else if (!extension.valid() || extension.type() != 16 || extension.careOfAddresses() < 1) {
+			LOGERROR("[Monitor] Advertisement message is sent without a valid mobility agent advertisement extension");
+			_counters.add(C_ADVERTISEMENTS_INVALID);
 		}
 		else {
 			LOG("[Monitor] Received a valid advertisement message");
-			MobilityAgentAdvertisementExtension* extension = (MobilityAgentAdvertisementExtension *) (p->data() + sizeof(ICMPAdvertisement));
-			uint16_t lifetime = ntohs(extension->registrationLifetime);
-			bool registerAgain = _updateSequenceNumber(ntohs(extension->sequenceNumber));
+			_counters.add(C_ADVERTISEMENTS);
+			IPAddress careOfAddress = _careOfAddress(_cacheAgent(p, srcIP, advertisement, extension, view.careOfWeights()));
+			TRACE_EVENT(this, TRACE_ADVERTISEMENT, srcIP.addr(), careOfAddress.addr(), 0, extension.sequenceNumber());
+			Timestamp solicitation = _solicitor->lastSolicitation();
+			bool solicited = destIP == _ipAddress
+				|| (solicitation && Timestamp::now_steady() - solicitation <= Timestamp::make_sec(MAX_RESPONSE_DELAY));
+			// An agent is in reach, the solicitor can be quiet
+			_solicitor->advertisementReceived(solicited);
+			bool sameAgent = srcIP == _currentAgent;
+			// Lazy cell switching: stay with the current agent while it is in the cache
+			const ICMPRouterEntry* current = _agents.find(_currentAgent.addr());
+			if (_lazy && !sameAgent && current && current->preferenceLevel >= (int32_t) ntohl(advertisement->preferenceLevel)) {
+				p->kill();
+				return;
+			}
+			_updateAgentDeadline(sameAgent, solicited, ntohs(advertisement->lifetime));
+			_detectHandover(srcIP);
+			uint16_t lifetime = extension.registrationLifetime();
+			bool registerAgain = _updateSequenceNumber(extension.sequenceNumber());
+			// The agent that was lost is back, it may have dropped the visitor meanwhile
+			bool agentBack = _agentLost && sameAgent;
+			_agentLost = false;
 			if (registerAgain && !sameNetwork(srcIP, _ipAddress)) {
 				LOGERROR("[Monitor] FA has rebooted, resend registration request");
-				_reqGenerator->generateRequest(srcIP, IPAddress(extension->careOfAddress), lifetime);
+				_reqGenerator->generateRequest(srcIP, careOfAddress, lifetime);
+			} else if (agentBack && !sameNetwork(srcIP, _ipAddress)) {
+				LOGERROR("[Monitor] Lost FA is back, resend registration request");
+				_reqGenerator->generateRequest(srcIP, careOfAddress, lifetime);
 			}
 			if (!sameNetwork(srcIP, _ipAddress)) {
 				// If the advertisement is not from the home agent
 				LOG("[Monitor] Mobile node is NOT AT HOME");
-				if (extension->R == 1 && !_reqGenerator->hasActiveRegistration(IPAddress(extension->careOfAddress))) {
-					_reqGenerator->generateRequest(srcIP, IPAddress(extension->careOfAddress), lifetime);
+				if ((extension.flags() & MobilityExtensionView::FLAG_R) && !_reqGenerator->hasActiveRegistration(careOfAddress)) {
+					_reqGenerator->generateRequest(srcIP, careOfAddress, lifetime);
 				}
 				_atHome = false;
 				return;
@@ -116,8 +291,8 @@ void Monitor::_handleAdvertisement(Packet* p) {
 void Monitor::_handleRegistrationReply(Packet* p) {
 	const click_ip* ipHeader = p->ip_header();
 	click_udp *udpHeader = (click_udp *) (p->data() + sizeof(click_ip));
-	RegistrationReply* reply = (RegistrationReply*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
-	if (reply->type != 3)
+	RegistrationReplyView reply = RegistrationReplyView::fromPacket(p);
+	if (!reply.valid() || reply.type() != 3)
 		return;
 	LOG("[Monitor] Received MobileIP Reply at the Mobile Node");
 	if (ntohs(udpHeader->uh_dport) != portUDP){
@@ -125,12 +300,25 @@ void Monitor::_handleRegistrationReply(Packet* p) {
 		return;
 	}
 	uint64_t pendingRegId = _reqGenerator->getActiveRegistrationID(ipHeader->ip_src);
-	if (pendingRegId != reply->identification) {
+	if (pendingRegId != reply.identification()) {
 		LOGERROR("[Monitor] Received registration reply packet with the wrong id.");
 		return;
 	}
-	if (reply->code == 0 || reply->code == 1){ // Registration was accepted
-		if (ntohs(reply->lifetime) == 0){
+	_counters.add(C_REPLIES + reply.code());
+	TRACE_EVENT(this, reply.code() <= 1 ? TRACE_REGISTRATION_ACCEPTED : TRACE_REGISTRATION_DENIED,
+		_ipAddress.addr(), ipHeader->ip_src.s_addr, reply.identification(), reply.code());
+	if (reply.code() == 0 || reply.code() == 1){ // Registration was accepted
+		Timestamp now = Timestamp::now_steady();
+		Timestamp sent = _reqGenerator->getRequestSent(reply.identification());
+		if (sent)
+			_registrationRTT.add((now - sent).usecval());
+		if (_inHandover && !_handover.reply && IPAddress(ipHeader->ip_src) == IPAddress(_handover.agent)) {
+			_handover.identification = reply.identification();
+			_handover.request = sent;
+			_handover.reply = now;
+			_handoverRegistration.add((now - _handover.advertisement).usecval());
+		}
+		if (reply.lifetime() == 0){
 			// Reply with lifetime 0 => stop the requests
 			_reqGenerator->stopRequests();
 		} else {
@@ -138,24 +326,30 @@ void Monitor::_handleRegistrationReply(Packet* p) {
 			// If the reply was valid and lifetime is not 0
 			// Update the responding registration in RequestGenerator in order to resend
 			// a registration request when its lifetime is almost expired at the home agent
-			_reqGenerator->updateRegistration(reply->identification, ntohs(reply->lifetime));
+			_reqGenerator->updateRegistration(reply.identification(), reply.lifetime());
 		}
-	} else if (reply->code == 64){
+	} else if (reply.code() >= 64 && reply.code() < 128 && reply.code() != 69) {
+		// Another foreign agent may accept the registration
+		_agents.remove(ipHeader->ip_src.s_addr);
+		if (IPAddress(ipHeader->ip_src) == _currentAgent)
+			_failover();
+	}
+	if (reply.code() == 64){
 		LOGERROR("[Monitor] The registration was denied by FA (reason unspecified)");
-	} else if (reply->code == 69){
-		LOGERROR("[Monitor] The registration was denied by FA (requested lifetime is too long (<=%d seconds))", ntohs(reply->lifetime));
-		_reqGenerator->generateRequest(IPAddress(ipHeader->ip_src), IPAddress(), ntohs(reply->lifetime));
-	} else if (reply->code == 70){
+	} else if (reply.code() == 69){
+		LOGERROR("[Monitor] The registration was denied by FA (requested lifetime is too long (<=%d seconds))", reply.lifetime());
+		_reqGenerator->generateRequest(IPAddress(ipHeader->ip_src), IPAddress(), reply.lifetime());
+	} else if (reply.code() == 70){
 		LOGERROR("[Monitor] The registration was denied by FA (poorly formed request)");
-	} else if (reply->code == 71){
+	} else if (reply.code() == 71){
 		LOGERROR("[Monitor] The registration was denied by FA (poorly formed reply)");
-	} else if (reply->code == 72){
+	} else if (reply.code() == 72){
 		LOGERROR("[Monitor] The registration was denied by FA (encapsulation is unavailable)");
-	} else if (reply->code == 128){
+	} else if (reply.code() == 128){
 		LOGERROR("[Monitor] The registration was denied by HA (reason unspecified)");
-	} else if (reply->code == 134){
+	} else if (reply.code() == 134){
 		LOGERROR("[Monitor] The registration was denied by HA (poorly formed request)");
-	} else if (reply->code == 136){
+	} else if (reply.code() == 136){
 		LOGERROR("[Monitor] The registration was denied by HA (reason unspecified)");
 	}
 }
@@ -179,5 +373,100 @@ bool Monitor::_updateSequenceNumber(unsigned int seqNumber){
 	return false;
 }
 
+enum { H_LAST_HANDOVER, H_AGENTS_LOST, H_AGENTS, H_RESET, H_HISTOGRAMS };
+enum { HISTOGRAM_RTT, HISTOGRAM_HANDOVER_REGISTRATION, HISTOGRAM_HANDOVER_DATA, HISTOGRAM_HANDOVER_GAP, HISTOGRAM_END };
+static const char* const histogramNames[] = { "rtt", "handover_registration", "handover_data", "handover_gap" };
+
+// Offset of an event from the advertisement of a handover, -1 if it did not happen
+static int64_t handoverOffset(const HandoverTimeline& handover, const Timestamp& t) {
+	if (!t)
+		return -1;
+	return (t - handover.advertisement).usecval();
+}
+
+String Monitor::read_handler(Element* e, void* thunk){
+	Monitor* monitor = (Monitor*) e;
+	intptr_t which = (intptr_t) thunk;
+	if (which == H_AGENTS_LOST)
+		return String(monitor->_counters.value(C_AGENTS_LOST));
+	if (which == H_AGENTS) {
+		StringAccum sa;
+		Timestamp now = Timestamp::now_steady();
+		for (int i = 0; i < monitor->_agents.size(); i++) {
+			const ICMPRouterEntry& entry = monitor->_agents[i];
+			sa << IPAddress(entry.routerAddress) << " preference " << entry.preferenceLevel
+			   << " lifetime " << (entry.expires - now).sec() << " sequence " << entry.sequenceNumber << " coa";
+			for (int j = 0; j < entry.careOfAddressCount; j++)
+				sa << ' ' << IPAddress(entry.careOfAddresses[j]) << " (" << (int) entry.careOfAddressWeights[j] << ')';
+			sa << '\n';
+		}
+		return sa.take_string();
+	}
+	if (which == H_LAST_HANDOVER) {
+		const HandoverTimeline& handover = monitor->_lastHandover;
+		if (!handover.advertisement)
+			return String();
+		StringAccum sa;
+		sa << "agent " << IPAddress(handover.agent)
+		   << " identification " << handover.identification
+		   << " last_data " << handoverOffset(handover, handover.lastData)
+		   << " request " << handoverOffset(handover, handover.request)
+		   << " reply " << handoverOffset(handover, handover.reply)
+		   << " first_data " << handoverOffset(handover, handover.firstData);
+		return sa.take_string();
+	}
+	const LatencyHistogram* histograms[] = { &monitor->_registrationRTT, &monitor->_handoverRegistration, &monitor->_handoverData, &monitor->_handoverGap };
+	which -= H_HISTOGRAMS;
+	return String(histograms[which / HISTOGRAM_STATS]->stat(which % HISTOGRAM_STATS));
+}
+
+int Monitor::write_handler(const String&, Element* e, void* thunk, ErrorHandler*){
+	Monitor* monitor = (Monitor*) e;
+	switch ((intptr_t) thunk) {
+		case H_RESET:
+			monitor->_registrationRTT.clear();
+			monitor->_handoverRegistration.clear();
+			monitor->_handoverData.clear();
+			monitor->_handoverGap.clear();
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void* Monitor::cast(const char* name){
+	if (strcmp(name, "MetricsSource") == 0)
+		return static_cast<MetricsSource*>(this);
+	return Element::cast(name);
+}
+
+void Monitor::writeMetrics(StringAccum& sa) const {
+	writeMetric(sa, this, "advertisements_received_total", _counters.value(C_ADVERTISEMENTS), "result=\"valid\"");
+	writeMetric(sa, this, "advertisements_received_total", _counters.value(C_ADVERTISEMENTS_INVALID), "result=\"invalid\"");
+	for (int code = 0; code < 256; code++)
+		if (uint64_t replies = _counters.value(C_REPLIES + code))
+			writeMetric(sa, this, "registration_replies_received_total", replies, "code=\"" + String(code) + "\"");
+	writeMetric(sa, this, "data_packets_total", _counters.value(C_DATA_PACKETS));
+	writeMetric(sa, this, "handovers_total", _counters.value(C_HANDOVERS));
+	writeMetric(sa, this, "agents_lost_total", _counters.value(C_AGENTS_LOST));
+	writeMetric(sa, this, "agent_failovers_total", _counters.value(C_FAILOVERS));
+	writeMetric(sa, this, "agents_cached", _agents.size());
+	const LatencyHistogram* histograms[] = { &_registrationRTT, &_handoverRegistration, &_handoverData, &_handoverGap };
+	for (int histogram = 0; histogram < HISTOGRAM_END; histogram++)
+		for (int stat = 0; stat < HISTOGRAM_STATS; stat++)
+			writeMetric(sa, this, (String(histogramNames[histogram]) + "_usec").c_str(), histograms[histogram]->stat(stat),
+				    String("stat=\"") + LatencyHistogram::statName(stat) + "\"");
+}
+
+void Monitor::add_handlers(){
+	for (int histogram = 0; histogram < HISTOGRAM_END; histogram++)
+		for (int stat = 0; stat < HISTOGRAM_STATS; stat++)
+			add_read_handler(String(histogramNames[histogram]) + "_" + LatencyHistogram::statName(stat), read_handler, H_HISTOGRAMS + histogram * HISTOGRAM_STATS + stat);
+	add_read_handler("last_handover", read_handler, H_LAST_HANDOVER);
+	add_read_handler("agents_lost", read_handler, H_AGENTS_LOST);
+	add_read_handler("agents", read_handler, H_AGENTS);
+	add_write_handler("reset", write_handler, H_RESET, Handler::BUTTON);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(Monitor)
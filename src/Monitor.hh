@@ -1,11 +1,17 @@
 #ifndef CLICK_MONITOR_HH
 #define CLICK_MONITOR_HH
 #include <click/element.hh>
+#include <click/timer.hh>
 
 // Local imports
 #include "RequestGenerator.hh"
 #include "Solicitor.hh"
-#include "structs/ICMPRouterEntry.hh"
+#include "structs/ICMPAdvertisement.hh"
+#include "structs/WireViews.hh"
+#include "structs/HandoverTimeline.hh"
+#include "utils/LatencyHistogram.hh"
+#include "utils/Metrics.hh"
+#include "utils/AgentCache.hh"
 #include <map>
 
 CLICK_DECLS
@@ -14,8 +20,40 @@ CLICK_DECLS
  *	Click element that will monitor for the mobile node
  *	It will receive incoming ICMP advertisement and handle them
  *	It will receive registration replies and if necessary send a new registration through the RequestGenerator class
+ *	It keeps the timeline of every handover: a handover starts with the first advertisement of
+ *	another agent and ends with the first data packet after the accepted registration
+ *	Movement detection (RFC 5944 2.4.2.1): the current agent is lost when its advertisements
+ *	stop for the lifetime of the last one, or for MISSED (default 3, 0 to only use the
+ *	lifetime) times the interval between its last two unsolicited advertisements. After an
+ *	answer to a solicitation (unicast, or within MAX_RESPONSE_DELAY of the last solicitation)
+ *	it is lost when it does not answer MISSED more solicitations. The mobile node then
+ *	starts a burst of solicitations (see Solicitor) and registers with the next agent it hears
+ *	of, also the same one again. Every valid advertisement quiets the solicitor.
+ *	Agent cache: the mobile node keeps the AGENTS (default 8) best agents it recently heard of
+ *	(see utils/AgentCache.hh). When it loses the current agent, or a foreign agent denies its
+ *	registration, it registers at once with the best other foreign agent of the cache that
+ *	it heard since it switched to the current agent, so on the same link. It never returns
+ *	home on a cached entry: the home agent has to advertise again (e.g. answer a solicitation).
+ *	With LAZY true (lazy cell switching, RFC 5944 2.4.2.2) the advertisement of another agent
+ *	only starts a handover when that agent has a higher preference or the current agent is no
+ *	longer in the cache, by default every other agent does (eager cell switching).
+ *	Read handlers (times in microseconds):
+ *	- rtt_<stat> ==> registration request to accepted reply
+ *	- handover_registration_<stat> ==> first advertisement of the new agent to accepted reply
+ *	- handover_data_<stat> ==> first advertisement of the new agent to first data packet
+ *	- handover_gap_<stat> ==> last data packet before to first data packet after the handover,
+ *	  the time the mobile node was unreachable
+ *	  stat: count, avg, p50, p99, p999, max
+ *	- last_handover ==> timeline of the last completed handover, relative to its advertisement
+ *	- agents_lost ==> times the advertisements of the current agent stopped (movement detection)
+ *	- agents ==> the agent cache, best first, one agent per line:
+ *	  <address> preference <p> lifetime <seconds left> sequence <n> coa <address> (<weight>)...
+ *	Write handlers:
+ *	- reset ==> clear the histograms
+ *	Metrics (see MetricsExporter): advertisements per result, replies per code, data packets,
+ *	handovers, agents lost, failovers to a cached agent, and the stats of the histograms above
 */
-class Monitor : public Element {
+class Monitor : public Element, public MetricsSource {
 	public:
 		Monitor();
 		~Monitor();
@@ -24,14 +62,25 @@ class Monitor : public Element {
 		const char *port_count() const	{ return "1/1"; }
 		const char *processing() const	{ return PUSH; }
 		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
     	void push(int, Packet* p);
+		void run_timer(Timer* t);
+		void add_handlers();
+		void* cast(const char*);
+		void writeMetrics(StringAccum&) const;
 
 		// Method to return if the MN is at home or not
 		bool isHome(){ return _atHome; }
 
 		RequestGenerator* getRequestGenerator(){ return _reqGenerator; }
 
+		// Ethernet address of the current agent, 0 if it is not in the agent cache
+		const uint8_t* agentEtherAddress() const;
+
 	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
 		// Keep track of the sequence numbers of the advertisements
 		uint16_t _currentSequenceNumber;
 
@@ -50,6 +99,59 @@ class Monitor : public Element {
 		// Boolean value which keeps track if MN is at home
 		bool _atHome;
 
+		// Agent of the last valid advertisement
+		IPAddress _currentAgent;
+
+		// Time the mobile node switched to the current agent: agents heard before were heard
+		// on another link, they are no candidates for a failover
+		Timestamp _attached;
+
+		// Time of the last data packet received
+		Timestamp _lastData;
+
+		// Handover in progress and the last completed one
+		bool _inHandover;
+		HandoverTimeline _handover;
+		HandoverTimeline _lastHandover;
+
+		// Advertisement, reply and data packet counters, see Monitor.cc
+		MetricCounters _counters;
+
+		LatencyHistogram _registrationRTT;
+		LatencyHistogram _handoverRegistration;
+		LatencyHistogram _handoverData;
+		LatencyHistogram _handoverGap;
+
+		// Movement detection: deadline of the advertisements of the current agent
+		unsigned _missed;
+		Timer _agentTimer;
+		Timestamp _lastAdvertisement;
+		Timestamp _advertisementInterval;
+		// The deadline passed, register with the next agent heard of
+		bool _agentLost;
+
+		// Start a handover when the advertisement is from another agent
+		void _detectHandover(IPAddress agent);
+
+		// Move the deadline of the current agent after one of its advertisements, answers to
+		// solicitations do not count for the interval between its advertisements
+		void _updateAgentDeadline(bool sameAgent, bool solicited, uint16_t lifetime);
+
+		// Agents recently heard of, best first
+		AgentCache _agents;
+		bool _lazy;
+
+		// Cache the agent of an advertisement, returns its entry
+		ICMPRouterEntry _cacheAgent(Packet* p, IPAddress agent, const ICMPAdvertisement* advertisement,
+					    const MobilityExtensionView& extension, const CareOfWeightsView& weights);
+
+		// Care of address of this mobile node among those of an agent (by a hash of its address
+		// and the weights of the addresses)
+		IPAddress _careOfAddress(const ICMPRouterEntry& entry) const;
+
+		// Register with the best cached agent other than the current one, false if there is none
+		bool _failover();
+
 		void _handleAdvertisement(Packet* p);
 		void _handleRegistrationReply(Packet* p);
 		bool _updateSequenceNumber(unsigned int);
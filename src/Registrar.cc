@@ -0,0 +1,816 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <clicknet/ether.h>
+#include <clicknet/udp.h>
+#include <clicknet/ip.h>
+
+// Local imports
+#include "Registrar.hh"
+#include "utils/Configurables.hh"
+#include "utils/EventTrace.hh"
+#include "utils/HelperFunctions.hh"
+#include <click/standard/scheduleinfo.hh>
+
+#if PATHSTATS
+// Paths timed with PATHSTATS
+enum { PATH_REQUEST, PATH_REPLY, PATH_END };
+static const char* const pathNames[] = { "request", "reply" };
+#endif
+
+// Counters of the registrations, replies are counted per code
+enum { C_REQUESTS_RELAYED, C_BINDINGS_CREATED, C_BINDINGS_RENEWED, C_BINDINGS_DELETED,
+       C_BINDINGS_EXPIRED, C_VISITORS_ADDED, C_VISITORS_ACCEPTED, C_VISITORS_REMOVED,
+       C_VISITORS_EXPIRED, C_STORE_DROPPED,
+       C_REPLIES_GENERATED, C_REPLIES_RELAYED = C_REPLIES_GENERATED + 256,
+       C_END = C_REPLIES_RELAYED + 256 };
+
+CLICK_DECLS
+Registrar::Registrar(): _task(this), _compactTask(this), _mobilityTimer(this), _head(0), _tail(0), _depth(0), _capacity(1000), _burst(32), _lifetime(registrationLifetime), _publicReplies(false), _drops(0), _processed(0), _latencyTotal(0), _latencyMax(0), _restored(0), _replayTime(0), _compactCursor(0), _compactBindings(false), _compactPosition(0){}
+
+Registrar::~ Registrar(){}
+
+int Registrar::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+	        "PUBLIC", cpkM, cpIPAddress, &_agentAddressPublic, \
+		"PRIVATE", cpkM, cpIPAddress, &_agentAddressPrivate, \
+		"ROUTINGELEMENT", cpkM, (RoutingElement*) cpElement, &_routingElement, \
+		"CAPACITY", cpkN, cpUnsigned, &_capacity, \
+		"BURST", cpkN, cpUnsigned, &_burst, \
+		"LIFETIME", cpkN, cpUnsignedShort, &_lifetime, \
+		"PUBLIC_REPLIES", cpkN, cpBool, &_publicReplies, \
+		"STORE", cpkN, cpFilename, &_storePath, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_capacity < 1)
+		return errh->error("CAPACITY must be at least 1");
+	if (_burst < 1)
+		return errh->error("BURST must be at least 1");
+	_counters.initialize(C_END);
+	return 0;
+}
+
+int Registrar::initialize(ErrorHandler *errh) {
+	_queue.resize(_capacity, 0);
+	_queued.resize(_capacity);
+#if PATHSTATS
+	_paths.initialize(PATH_END);
+#endif
+	ScheduleInfo::initialize_task(this, &_task, errh);
+	_compactTask.initialize(this, false);
+	// Initialize timer object
+	// It is only scheduled once a binding or visitor with a finite lifetime exists
+	_mobilityTimer.initialize(this);
+	if (_storePath) {
+		if (_store.open(_storePath, errh) < 0)
+			return -1;
+		Timestamp start = Timestamp::now_steady();
+		if (_replayStore(errh) < 0)
+			return -1;
+		_replayTime = (Timestamp::now_steady() - start).usecval();
+	}
+	return 0;
+}
+
+void Registrar::cleanup(CleanupStage){
+	Packet* p;
+	Timestamp queued;
+	while (_dequeue(p, queued))
+		p->kill();
+}
+
+void Registrar::run_timer(Timer* t){
+	if (t == &_mobilityTimer){
+		Timestamp now = Timestamp::now_steady();
+		_expireMobilityBindings(now);
+		_expireVisitors(now);
+		_rescheduleExpiryTimer();
+	}
+}
+
+void Registrar::push(int, Packet* p){
+	_queueLock.acquire();
+	if (_depth == _capacity) {
+		_drops++;
+		_queueLock.release();
+		p->kill();
+		return;
+	}
+	_queue[_tail] = p;
+	_queued[_tail] = Timestamp::now_steady();
+	_tail = (_tail + 1) % _capacity;
+	_depth++;
+	_queueLock.release();
+	_task.reschedule();
+}
+
+bool Registrar::_dequeue(Packet*& p, Timestamp& queued){
+	_queueLock.acquire();
+	if (_depth == 0) {
+		_queueLock.release();
+		return false;
+	}
+	p = _queue[_head];
+	queued = _queued[_head];
+	_head = (_head + 1) % _capacity;
+	_depth--;
+	_queueLock.release();
+	return true;
+}
+
+bool Registrar::run_task(Task* task){
+	if (task == &_compactTask)
+		return _compactStep(ErrorHandler::default_handler());
+	unsigned count = 0;
+	Packet* p;
+	Timestamp queued;
+	while (count < _burst && _dequeue(p, queued)) {
+		// The relays rewrite the message in place, it may be shared (e.g. by a Tee)
+		if (!(p = p->uniqueify())) {
+			count++;
+			continue;
+		}
+		const click_udp* udpHeader = (const click_udp*) (p->data() + sizeof(click_ip));
+		PATHSTATS_START(start);
+		if (ntohs(udpHeader->uh_dport) == 434) {
+			// Registration request
+			_registrationRequestResponse(p);
+			PATHSTATS_RECORD(_paths, PATH_REQUEST, start);
+		}
+		else if (ntohs(udpHeader->uh_sport) == 434) {
+			// Registration reply relayed to the mobile node
+			_registrationReplyRelay(p);
+			PATHSTATS_RECORD(_paths, PATH_REPLY, start);
+		}
+		else
+			p->kill();
+		uint64_t latency = (Timestamp::now_steady() - queued).usecval();
+		_latencyTotal += latency;
+		if (latency > _latencyMax)
+			_latencyMax = latency;
+		_processed++;
+		count++;
+	}
+	// Leave room for the forwarding path between bursts
+	if (count == _burst)
+		_task.fast_reschedule();
+	return count > 0;
+}
+
+enum { H_QUEUE_DEPTH, H_DROPS, H_PROCESSED, H_LATENCY_AVG, H_LATENCY_MAX, H_RESET_LATENCY,
+       H_STORE_RECORDS, H_STORE_RESTORED, H_STORE_REPLAY_USEC, H_STORE_DROPPED, H_LIFETIME, H_PUBLIC_REPLIES, H_CLEAR,
+       H_RESET_PATHS, H_PATHS };
+
+String Registrar::read_handler(Element* e, void* thunk){
+	Registrar* registrar = (Registrar*) e;
+	switch ((intptr_t) thunk) {
+		case H_QUEUE_DEPTH:
+			return String(registrar->_depth);
+		case H_DROPS:
+			return String(registrar->_drops);
+		case H_PROCESSED:
+			return String(registrar->_processed);
+		case H_LATENCY_AVG:
+			if (registrar->_processed == 0)
+				return String(0);
+			return String(registrar->_latencyTotal / registrar->_processed);
+		case H_LATENCY_MAX:
+			return String(registrar->_latencyMax);
+		case H_STORE_RECORDS:
+			return String(registrar->_store.records());
+		case H_STORE_RESTORED:
+			return String(registrar->_restored);
+		case H_STORE_REPLAY_USEC:
+			return String(registrar->_replayTime);
+		case H_STORE_DROPPED:
+			return String(registrar->_counters.value(C_STORE_DROPPED));
+		case H_LIFETIME:
+			return String(registrar->_lifetime);
+		case H_PUBLIC_REPLIES:
+			return String(registrar->_publicReplies);
+		default:
+#if PATHSTATS
+			if ((intptr_t) thunk >= H_PATHS) {
+				int path = ((intptr_t) thunk - H_PATHS) / HISTOGRAM_STATS;
+				int stat = ((intptr_t) thunk - H_PATHS) % HISTOGRAM_STATS;
+				return String(registrar->_paths.stat(path, stat));
+			}
+#endif
+			return String();
+	}
+}
+
+int Registrar::write_handler(const String& input, Element* e, void* thunk, ErrorHandler* errh){
+	Registrar* registrar = (Registrar*) e;
+	switch ((intptr_t) thunk) {
+		case H_LIFETIME: {
+			unsigned lifetime;
+			if (!cp_integer(input, &lifetime) || lifetime > 0xffff)
+				return errh->error("lifetime must be an integer from 0 to 65535");
+			registrar->_lifetime = lifetime;
+			return 0;
+		}
+		case H_PUBLIC_REPLIES:
+			if (!cp_bool(input, &registrar->_publicReplies))
+				return errh->error("public_replies must be a boolean");
+			return 0;
+		case H_CLEAR:
+			registrar->_clear();
+			return 0;
+		case H_RESET_LATENCY:
+			registrar->_processed = 0;
+			registrar->_latencyTotal = 0;
+			registrar->_latencyMax = 0;
+			return 0;
+#if PATHSTATS
+		case H_RESET_PATHS:
+			registrar->_paths.clear();
+			return 0;
+#endif
+		default:
+			return -1;
+	}
+}
+
+void* Registrar::cast(const char* name){
+	if (strcmp(name, "MetricsSource") == 0)
+		return static_cast<MetricsSource*>(this);
+	return Element::cast(name);
+}
+
+void Registrar::writeMetrics(StringAccum& sa) const {
+	// Only the codes that occurred, most of the 256 never do
+	for (int code = 0; code < 256; code++) {
+		if (uint64_t generated = _counters.value(C_REPLIES_GENERATED + code))
+			writeMetric(sa, this, "registration_replies_total", generated, "origin=\"generated\",code=\"" + String(code) + "\"");
+		if (uint64_t relayed = _counters.value(C_REPLIES_RELAYED + code))
+			writeMetric(sa, this, "registration_replies_total", relayed, "origin=\"relayed\",code=\"" + String(code) + "\"");
+	}
+	writeMetric(sa, this, "registration_requests_relayed_total", _counters.value(C_REQUESTS_RELAYED));
+	writeMetric(sa, this, "registration_processed_total", _processed);
+	writeMetric(sa, this, "registration_drops_total", _drops);
+	writeMetric(sa, this, "binding_events_total", _counters.value(C_BINDINGS_CREATED), "event=\"created\"");
+	writeMetric(sa, this, "binding_events_total", _counters.value(C_BINDINGS_RENEWED), "event=\"renewed\"");
+	writeMetric(sa, this, "binding_events_total", _counters.value(C_BINDINGS_DELETED), "event=\"deleted\"");
+	writeMetric(sa, this, "binding_events_total", _counters.value(C_BINDINGS_EXPIRED), "event=\"expired\"");
+	writeMetric(sa, this, "visitor_events_total", _counters.value(C_VISITORS_ADDED), "event=\"added\"");
+	writeMetric(sa, this, "visitor_events_total", _counters.value(C_VISITORS_ACCEPTED), "event=\"accepted\"");
+	writeMetric(sa, this, "visitor_events_total", _counters.value(C_VISITORS_REMOVED), "event=\"removed\"");
+	writeMetric(sa, this, "visitor_events_total", _counters.value(C_VISITORS_EXPIRED), "event=\"expired\"");
+	if (_storePath)
+		writeMetric(sa, this, "store_dropped_records_total", _counters.value(C_STORE_DROPPED));
+}
+
+void Registrar::add_handlers(){
+	add_read_handler("queue_depth", read_handler, H_QUEUE_DEPTH);
+	add_read_handler("drops", read_handler, H_DROPS);
+	add_read_handler("processed", read_handler, H_PROCESSED);
+	add_read_handler("latency_avg", read_handler, H_LATENCY_AVG);
+	add_read_handler("latency_max", read_handler, H_LATENCY_MAX);
+	add_read_handler("store_records", read_handler, H_STORE_RECORDS);
+	add_read_handler("store_restored", read_handler, H_STORE_RESTORED);
+	add_read_handler("store_replay_usec", read_handler, H_STORE_REPLAY_USEC);
+	add_read_handler("store_dropped", read_handler, H_STORE_DROPPED);
+	add_read_handler("lifetime", read_handler, H_LIFETIME);
+	add_write_handler("lifetime", write_handler, H_LIFETIME);
+	add_read_handler("public_replies", read_handler, H_PUBLIC_REPLIES);
+	add_write_handler("public_replies", write_handler, H_PUBLIC_REPLIES);
+	add_write_handler("reset_latency", write_handler, H_RESET_LATENCY, Handler::BUTTON);
+	add_write_handler("clear", write_handler, H_CLEAR, Handler::BUTTON);
+#if PATHSTATS
+	for (int path = 0; path < PATH_END; path++)
+		for (int stat = 0; stat < HISTOGRAM_STATS; stat++)
+			add_read_handler(String("path_") + pathNames[path] + "_" + LatencyHistogram::statName(stat), read_handler, H_PATHS + path * HISTOGRAM_STATS + stat);
+	add_write_handler("reset_paths", write_handler, H_RESET_PATHS, Handler::BUTTON);
+#endif
+	add_task_handlers(&_task);
+}
+
+// Relay on output port 1
+// Reply on port 0 private/1 public.
+void Registrar::_registrationRequestResponse(Packet* p) {
+	click_ip* iph = (click_ip*) p->data();
+	uint32_t dstAddressRequest = ntohl(IPAddress(iph->ip_dst).addr());
+	click_udp* udpHeader = (click_udp*) (p->data() + sizeof(click_ip));
+	LOG("[Registrar] Received a registration request at agent side");
+	RegistrationRequest* request =
+	(RegistrationRequest*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
+	// If the request is for another agent
+	if (request->homeAgent != _agentAddressPublic.addr()){
+		// Relay the registration request to port 1
+		LOG("[Registrar] Received a request not for the agent itself, relaying it");
+		iph->ip_src = _agentAddressPublic.in_addr();
+		iph->ip_dst = IPAddress(request->homeAgent).in_addr();
+		iph->ip_len = htons(p->length());
+		p->set_dst_ip_anno(IPAddress(iph->ip_dst));
+		// FA needs to check incoming requests and
+		// generate possible replies to it (see chapter 3.3)
+		// If incoming request at the FA is invalid ==> send reply immediately
+		RegistrationRequest* request =
+		(RegistrationRequest*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
+		if (_checkRequest(request, false) != 1 &&
+		    _checkRequest(request, false) != 0) {
+			LOGERROR("[Registrar] FA received an invalid request, "
+			 	 "error code %d", _checkRequest(request, false));
+			Packet* reply = _generateReply(IPAddress(request->homeAddress),
+						       udpHeader->uh_dport,
+						       udpHeader->uh_sport,
+						       request,
+					       	       false);
+			p->kill();
+			output(0).push(reply);
+			return;
+		}
+
+		// Request was valid so add entry in the visitors list
+		uint16_t udpPort = ntohs(udpHeader->uh_sport);
+		_addPendingVisitor(request, dstAddressRequest, udpPort);
+
+		// Set the UDP header checksum based on the initialized values
+		//unsigned csum = click_in_cksum((unsigned char *)udpHeader, sizeof(click_udp) + sizeof(RegistrationRequest));
+		//udpHeader->uh_sum = click_in_cksum_pseudohdr(csum, iph, sizeof(click_udp) + sizeof(RegistrationRequest));
+		// Packets on output 1 carry a valid IP checksum
+		iph->ip_sum = 0;
+		iph->ip_sum = click_in_cksum((unsigned char *)iph, sizeof(click_ip));
+		_counters.add(C_REQUESTS_RELAYED);
+		output(1).push(p);
+		return;
+	}
+	// If the request is for the agent itself or 255.255.255.255
+	if (request->homeAgent == _agentAddressPublic.addr() || request->homeAgent == broadCast.addr()){
+		// Handle the registration request
+		LOG("[Registrar] Received a request for the agent itself, don't relay");
+		RegistrationRequest* request =
+		(RegistrationRequest*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
+
+		uint8_t replyCode = _checkRequest(request, true);
+		bool validRequest = (replyCode == 1 || replyCode == 0);
+		MobilityBinding mobilityData;
+		mobilityData.homeAddress = request->homeAddress;
+		mobilityData.careOfAddress = request->careOfAddress;
+		mobilityData.lifetime = ntohs(request->lifetime);
+		mobilityData.expires = Timestamp::now_steady() + Timestamp::make_sec(mobilityData.lifetime);
+		mobilityData.replyIdentification = request->identification;
+		IPAddress replyDestination = _updateMobilityBindings(mobilityData, validRequest);
+
+		// Generate the reply
+		Packet* replyPacket = _generateReply(replyDestination,
+						     udpHeader->uh_dport,
+						     udpHeader->uh_sport,
+						     request, true);
+
+		// Kill the request packet
+		p->kill();
+
+		// Push reply
+		if (sameNetwork(replyPacket->dst_ip_anno(), _agentAddressPrivate)){
+			LOG("[Registrar] Pushing reply to local network");
+			output(0).push(replyPacket);
+			return;
+		}
+		output(1).push(replyPacket);
+		return;
+	}
+}
+
+// Relay the registration reply on the private network (to the MN)
+void Registrar::_registrationReplyRelay(Packet* p) {
+	click_ip* iph = (click_ip*) p->data();
+	click_udp* udpHeader = (click_udp*) (p->data() + sizeof(click_ip));
+	LOG("[Registrar] Received a reply message at agent side, forwarding to MN");
+	RegistrationReply* reply =
+	(RegistrationReply*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
+	// Check if port is corresponding with the port used in the request
+	VisitorEntry entry;
+	bool poorlyFormed = !_routingElement->visitorTable()->find(VisitorKey(ntohl(reply->homeAddress), reply->identification), entry);
+	if (poorlyFormed) {
+		LOGERROR("[Registrar] Received registration reply packet that is poorly formed");
+		reply->code = 71;
+		_deletePendingVisitor(reply);
+		iph->ip_src = _agentAddressPrivate.in_addr();
+		iph->ip_dst = IPAddress(reply->homeAddress).in_addr();
+		iph->ip_len = htons(p->length());
+		p->set_dst_ip_anno(IPAddress(iph->ip_dst));
+		_counters.add(C_REPLIES_RELAYED + reply->code);
+		output(0).push(p);
+		return;
+	}
+	if (entry.udpSourcePort != ntohs(udpHeader->uh_dport)){
+		LOGERROR("[Registrar] Received registration reply packet on UDP port %d, but expected port %d", ntohs(udpHeader->uh_dport), entry.udpSourcePort);
+		_deletePendingVisitor(reply);
+		p->kill();
+		return;
+	}
+	if (!poorlyFormed && (reply->code == 1 || reply->code == 0))
+		_updateVisitors(reply);
+	if (reply->code != 0 && reply->code != 1)
+		_deletePendingVisitor(reply);
+	iph->ip_src = _agentAddressPrivate.in_addr();
+	iph->ip_dst = IPAddress(reply->homeAddress).in_addr();
+	iph->ip_len = htons(p->length());
+	p->set_dst_ip_anno(IPAddress(iph->ip_dst));
+	_counters.add(C_REPLIES_RELAYED + reply->code);
+	output(0).push(p);
+}
+
+Packet* Registrar::_generateReply(IPAddress dstAddress, uint16_t srcPort, uint16_t dstPort, RegistrationRequest* request, bool homeAgent){
+	LOG("[Registrar] Reply to MobileIP request message");
+	int tailroom = 0;
+	int headroom = sizeof(click_ether) + 4;
+	int packetsize = sizeof(click_ip) + sizeof(click_udp) + sizeof(RegistrationReply);
+	WritablePacket* packet = Packet::make(headroom, 0, packetsize, tailroom);
+	memset(packet->data(), 0, packet->length());
+
+	// IP header
+	click_ip *iph = (click_ip *) packet->data();
+	iph->ip_v = 4;
+	iph->ip_hl = sizeof(click_ip) >> 2;
+	iph->ip_len = htons(packet->length());
+	iph->ip_id = htons(0);
+	iph->ip_p = IP_PROTO_UDP; // UDP protocol
+	iph->ip_tos = 0x00;
+	iph->ip_ttl = 64;
+	iph->ip_dst = dstAddress.in_addr();
+	iph->ip_src = _agentAddressPublic.in_addr();
+	if (sameNetwork(_agentAddressPrivate, dstAddress) && !(homeAgent && _publicReplies))
+		iph->ip_src = _agentAddressPrivate.in_addr();
+
+	iph->ip_sum = click_in_cksum((unsigned char *)iph, sizeof(click_ip));
+	packet->set_dst_ip_anno(IPAddress(iph->ip_dst));
+
+	// UDP header
+	click_udp *udpHeader = (click_udp *) (packet->data() + sizeof(click_ip));
+	udpHeader->uh_sport = srcPort;
+	udpHeader->uh_dport = dstPort;
+	udpHeader->uh_ulen = htons(packet->length() - sizeof(click_ip));
+	udpHeader->uh_sum = 0;
+
+
+	RegistrationReply* reply =
+	(RegistrationReply*) (packet->data() + sizeof(click_ip) + sizeof(click_udp));
+	reply->type = 3;
+	reply->code = _checkRequest(request, homeAgent);
+	reply->lifetime = request->lifetime;
+	if (homeAgent && (ntohs(request->lifetime) > _lifetime)) reply->lifetime = htons(_lifetime);
+	if (!homeAgent && (reply->code == 69)) reply->lifetime = htons(maxLifetimeForeignAgent);
+	reply->homeAddress = IPAddress(request->homeAddress).addr();
+	reply->homeAgent = IPAddress(request->homeAgent).addr();
+	reply->identification = request->identification;
+	_counters.add(C_REPLIES_GENERATED + reply->code);
+	TRACE_EVENT(this, reply->code <= 1 ? TRACE_REGISTRATION_ACCEPTED : TRACE_REGISTRATION_DENIED,
+		request->homeAddress, request->careOfAddress, request->identification, reply->code);
+
+	// Set the UDP header checksum based on the initialized values
+	unsigned csum = click_in_cksum((unsigned char *)udpHeader, sizeof(click_udp) + sizeof(RegistrationReply));
+	udpHeader->uh_sum = click_in_cksum_pseudohdr(csum, iph, sizeof(click_udp) + sizeof(RegistrationReply));
+
+	return packet;
+}
+
+IPAddress Registrar::_updateMobilityBindings(MobilityBinding data, bool valid){
+	// This element is the only writer of the binding table, so lookups need no read section
+	BindingTable* mobilityBindings = _routingElement->bindingTable();
+	LOG("[Registrar] Mobility bindings size = %d", mobilityBindings->size());
+	const MobilityBinding* current = mobilityBindings->lookup(IPAddress(data.homeAddress));
+	if (current){ // MN has an active binding
+		if (data.lifetime == 0) {
+			// If MN deregisters a specific binding with lifetime 0
+			// MN is back home
+			// erase() may free the binding at once, keep its care of address for the trace
+			uint32_t careOfAddress = current->careOfAddress;
+			if (valid && mobilityBindings->erase(IPAddress(data.homeAddress))) {
+				_bindingExpiry.cancel(IPAddress(data.homeAddress));
+				_counters.add(C_BINDINGS_DELETED);
+				TRACE_EVENT(this, TRACE_BINDING_DELETED, data.homeAddress, careOfAddress, 0, 0);
+				_log(BindingStore::bindingEraseRecord(data.homeAddress));
+			}
+			return IPAddress(data.homeAddress);
+		}
+		// MN sends a new valid request for an existing binding
+		// and a new version of the according binding is published
+		if (valid) {
+			MobilityBinding updated = *current;
+			updated.lifetime = data.lifetime;
+			updated.expires = data.expires;
+			// The MN may have moved to another foreign agent
+			if (updated.careOfAddress != data.careOfAddress) {
+				updated.careOfAddress = data.careOfAddress;
+				buildTunnelHeader(updated, _agentAddressPublic);
+			}
+			mobilityBindings->set(updated);
+			_counters.add(C_BINDINGS_RENEWED);
+			TRACE_EVENT(this, TRACE_BINDING_RENEWED, updated.homeAddress, updated.careOfAddress, 0, updated.lifetime);
+			_log(BindingStore::bindingRecord(updated));
+		}
+	} else if (valid && data.lifetime != 0) {
+		// If MN has no active binding, add it to the table
+		buildTunnelHeader(data, _agentAddressPublic);
+		mobilityBindings->set(data);
+		_counters.add(C_BINDINGS_CREATED);
+		TRACE_EVENT(this, TRACE_BINDING_CREATED, data.homeAddress, data.careOfAddress, 0, data.lifetime);
+		_log(BindingStore::bindingRecord(data));
+	}
+	if (valid && data.lifetime != 0 && data.lifetime != 0xffff) {
+		_bindingExpiry.schedule(IPAddress(data.homeAddress), data.expires);
+		_rescheduleExpiryTimer();
+	} else if (valid && data.lifetime == 0xffff)
+		_bindingExpiry.cancel(IPAddress(data.homeAddress));
+	return IPAddress(data.careOfAddress);
+}
+
+void Registrar::_updateVisitors(RegistrationReply* reply) {
+	// MN source address is the same as the reply homeAddress
+	uint16_t remainingLifetime = ntohs(reply->lifetime);
+	if (maxLifetimeForeignAgent < remainingLifetime) remainingLifetime = maxLifetimeForeignAgent;
+	Timestamp expires = Timestamp::now_steady() + Timestamp::make_sec(remainingLifetime);
+	VisitorKey key(ntohl(reply->homeAddress), reply->identification);
+	VisitorEntry accepted;
+	Vector<uint64_t> erased;
+	bool found = _routingElement->visitorTable()->accept(key, ntohs(reply->lifetime), expires, accepted, &erased);
+	// The older entries of the MN are gone, and so are their deadlines
+	for (int i = 0; i < erased.size(); i++)
+		_visitorExpiry.cancel(VisitorKey(key.homeAddress, erased[i]));
+	if (found) {
+		_counters.add(C_VISITORS_ACCEPTED);
+		TRACE_EVENT(this, TRACE_VISITOR_ACCEPTED, reply->homeAddress, reply->homeAgent, reply->identification, ntohs(reply->lifetime));
+	}
+	_log(BindingStore::visitorAcceptRecord(key, ntohs(reply->lifetime), expires));
+	if (found && accepted.requestLifetime != 0xffff) {
+		_visitorExpiry.schedule(VisitorKey(accepted.sourceIPAddress, accepted.identification), accepted.expires);
+		_rescheduleExpiryTimer();
+	} else if (found)
+		_visitorExpiry.cancel(key);
+}
+
+void Registrar::_addPendingVisitor(RegistrationRequest* request, uint32_t dst, uint16_t port){
+	VisitorEntry entry;
+	entry.linkLayerAddress = 0;
+	entry.sourceIPAddress = ntohl(request->homeAddress);
+	entry.destinationIPAddress = dst;
+	entry.udpSourcePort = port;
+	entry.homeAgentAddress = ntohl(request->homeAgent);
+	entry.identification = request->identification;
+	entry.requestLifetime = ntohs(request->lifetime);
+	// The request is given up if the home agent does not reply in time
+	entry.expires = Timestamp::now_steady() + Timestamp::make_sec(maxPendingTimeForeignAgent);
+	entry.state = VISITOR_PENDING;
+	_routingElement->visitorTable()->add(entry, maxPendingPerVisitor);
+	_counters.add(C_VISITORS_ADDED);
+	TRACE_EVENT(this, TRACE_VISITOR_ADDED, request->homeAddress, request->homeAgent, request->identification, entry.requestLifetime);
+	_log(BindingStore::visitorRecord(STORE_VISITOR_ADD, entry));
+	// A retransmission of an accepted request keeps the accepted entry and its expiry
+	if (entry.state == VISITOR_PENDING) {
+		_visitorExpiry.schedule(VisitorKey(entry.sourceIPAddress, entry.identification), entry.expires);
+		_rescheduleExpiryTimer();
+	}
+}
+
+void Registrar::_deletePendingVisitor(RegistrationReply* reply){
+	// MN source address is the same as the reply homeAddress
+	// and identification field match
+	VisitorKey key(ntohl(reply->homeAddress), reply->identification);
+	if (_routingElement->visitorTable()->erasePending(key)) {
+		_visitorExpiry.cancel(key);
+		_counters.add(C_VISITORS_REMOVED);
+		TRACE_EVENT(this, TRACE_VISITOR_REMOVED, reply->homeAddress, reply->homeAgent, reply->identification, 0);
+		_log(BindingStore::visitorEraseRecord(key));
+	}
+}
+
+void Registrar::_expireMobilityBindings(const Timestamp& now){
+	BindingTable* mobilityBindings = _routingElement->bindingTable();
+	IPAddress homeAddress;
+	Timestamp deadline;
+	while (_bindingExpiry.popExpired(now, homeAddress, deadline)){
+		const MobilityBinding* binding = mobilityBindings->lookup(homeAddress);
+		// Renewals move the deadline and deletions cancel it, a mismatch is skipped all the same
+		if (!binding || binding->lifetime == 0xffff || binding->expires != deadline)
+			continue;
+		LOG("Registration was not renewed in time, so delete it from the active bindings");
+		TRACE_EVENT(this, TRACE_BINDING_EXPIRED, binding->homeAddress, binding->careOfAddress, 0, 0);
+		mobilityBindings->erase(homeAddress);
+		_counters.add(C_BINDINGS_EXPIRED);
+	}
+}
+
+void Registrar::_expireVisitors(const Timestamp& now){
+	VisitorKey key;
+	Timestamp deadline;
+	while (_visitorExpiry.popExpired(now, key, deadline)){
+		// Skip the deadlines of pending visitors that were evicted for newer requests
+		if (_routingElement->visitorTable()->expire(key, deadline)) {
+			LOG("Registration was not renewed in time, so delete it from the visitors list");
+			_counters.add(C_VISITORS_EXPIRED);
+			TRACE_EVENT(this, TRACE_VISITOR_EXPIRED, htonl(key.homeAddress), 0, key.identification, 0);
+		}
+	}
+}
+
+void Registrar::_rescheduleExpiryTimer(){
+	Timestamp next;
+	if (!_bindingExpiry.empty())
+		next = _bindingExpiry.nextDeadline();
+	if (!_visitorExpiry.empty() && (!next || _visitorExpiry.nextDeadline() < next))
+		next = _visitorExpiry.nextDeadline();
+	if (!next)
+		return;
+	if (!_mobilityTimer.scheduled() || next < _mobilityTimer.expiry_steady())
+		_mobilityTimer.schedule_at_steady(next);
+}
+
+void Registrar::_log(const StoreRecord& record){
+	if (!_storePath)
+		return;
+	if (!_store.append(record)) {
+		_counters.add(C_STORE_DROPPED);
+		LOGERROR("[Registrar] %s is closed, record of type %d not logged", _storePath.c_str(), record.type);
+		return;
+	}
+	// Expired entries are not logged, they are dropped on replay and by compaction
+	uint64_t live = _routingElement->bindingTable()->size() + _routingElement->visitorTable()->size();
+	if (!_store.compacting() && _store.records() > 2 * live + BINDINGSTORE_INITIAL_RECORDS)
+		_compactStore(ErrorHandler::default_handler());
+}
+
+static void collectBinding(const MobilityBinding& binding, void* data){
+	((Vector<MobilityBinding>*) data)->push_back(binding);
+}
+
+void Registrar::_clear(){
+	BindingTable* mobilityBindings = _routingElement->bindingTable();
+	Vector<MobilityBinding> bindings;
+	mobilityBindings->forEach(collectBinding, &bindings);
+	for (int i = 0; i < bindings.size(); i++) {
+		if (mobilityBindings->erase(IPAddress(bindings[i].homeAddress))) {
+			_counters.add(C_BINDINGS_DELETED);
+			TRACE_EVENT(this, TRACE_BINDING_DELETED, bindings[i].homeAddress, bindings[i].careOfAddress, 0, 0);
+			_log(BindingStore::bindingEraseRecord(bindings[i].homeAddress));
+		}
+	}
+	Vector<VisitorEntry> visitors;
+	_routingElement->visitorTable()->entries(visitors);
+	for (int i = 0; i < visitors.size(); i++) {
+		VisitorKey key(visitors[i].sourceIPAddress, visitors[i].identification);
+		if (_routingElement->visitorTable()->erase(key)) {
+			_counters.add(C_VISITORS_REMOVED);
+			TRACE_EVENT(this, TRACE_VISITOR_REMOVED, htonl(key.homeAddress), htonl(visitors[i].homeAgentAddress), key.identification, 0);
+			_log(BindingStore::visitorEraseRecord(key));
+		}
+	}
+	_bindingExpiry.clear();
+	_visitorExpiry.clear();
+	_mobilityTimer.unschedule();
+}
+
+int Registrar::_replayStore(ErrorHandler* errh){
+	BindingTable* mobilityBindings = _routingElement->bindingTable();
+	VisitorTable* visitors = _routingElement->visitorTable();
+	VisitorEntry accepted;
+	for (uint64_t i = 0; i < _store.records(); i++) {
+		const StoreRecord& record = _store.record(i);
+		switch (record.type) {
+			case STORE_BINDING_SET:
+				{
+					MobilityBinding binding = BindingStore::binding(record);
+					buildTunnelHeader(binding, _agentAddressPublic);
+					mobilityBindings->set(binding);
+					break;
+				}
+			case STORE_BINDING_ERASE:
+				mobilityBindings->erase(IPAddress(record.homeAddress));
+				break;
+			case STORE_VISITOR_ADD:
+				{
+					VisitorEntry entry = BindingStore::visitor(record);
+					if (entry.state == VISITOR_PENDING)
+						visitors->add(entry, maxPendingPerVisitor);
+					else
+						visitors->restore(entry);
+					break;
+				}
+			case STORE_VISITOR_ACCEPT:
+				visitors->accept(VisitorKey(record.homeAddress, record.identification), record.lifetime,
+						 BindingStore::visitor(record).expires, accepted);
+				break;
+			case STORE_VISITOR_ERASE:
+				visitors->erase(VisitorKey(record.homeAddress, record.identification));
+				break;
+			default:
+				return errh->error("%s: unknown record type %d", _storePath.c_str(), record.type);
+		}
+	}
+
+	// Drop what expired while the agent was down, schedule the expiry of the rest
+	Timestamp now = Timestamp::now_steady();
+	Vector<MobilityBinding> bindings;
+	mobilityBindings->forEach(collectBinding, &bindings);
+	for (Vector<MobilityBinding>::iterator it = bindings.begin(); it != bindings.end(); it++) {
+		if (it->lifetime == 0xffff)
+			continue;
+		if (it->expires <= now)
+			mobilityBindings->erase(IPAddress(it->homeAddress));
+		else
+			_bindingExpiry.schedule(IPAddress(it->homeAddress), it->expires);
+	}
+	Vector<VisitorEntry> entries;
+	visitors->entries(entries);
+	for (Vector<VisitorEntry>::iterator it = entries.begin(); it != entries.end(); it++) {
+		if (it->state == VISITOR_ACCEPTED && it->requestLifetime == 0xffff)
+			continue;
+		if (it->expires <= now)
+			visitors->erase(VisitorKey(it->sourceIPAddress, it->identification));
+		else
+			_visitorExpiry.schedule(VisitorKey(it->sourceIPAddress, it->identification), it->expires);
+	}
+	_rescheduleExpiryTimer();
+	_restored = mobilityBindings->size() + visitors->size();
+	// The log is not compacted here, that would delay the first tunneled packet
+	return 0;
+}
+
+static void collectBindingRecord(const MobilityBinding& binding, void* data){
+	((Vector<StoreRecord>*) data)->push_back(BindingStore::bindingRecord(binding));
+}
+
+int Registrar::_compactStore(ErrorHandler* errh){
+	// The new log is written by _compactTask, changes made meanwhile are appended to
+	// the old log and copied over at the end. Visitors are copied right away, the
+	// binding table is walked in steps.
+	if (_store.compactBegin(errh) < 0)
+		return -1;
+	_compactCursor = 0;
+	_compactBindings = true;
+	Vector<VisitorEntry> entries;
+	_routingElement->visitorTable()->entries(entries);
+	_compactVisitors.clear();
+	for (Vector<VisitorEntry>::iterator it = entries.begin(); it != entries.end(); it++)
+		_compactVisitors.push_back(BindingStore::visitorRecord(STORE_VISITOR_ADD, *it));
+	_compactPosition = 0;
+	_compactTask.reschedule();
+	return 0;
+}
+
+bool Registrar::_compactStep(ErrorHandler* errh){
+	if (!_store.compacting())
+		return false;
+	if (_compactBindings) {
+		Vector<StoreRecord> records;
+		_compactBindings = _routingElement->bindingTable()->forEachStep(_compactCursor, BINDINGSTORE_COMPACT_STEP, collectBindingRecord, &records);
+		if (_store.compactWrite(records.begin(), records.size(), errh) < 0)
+			return false;
+		_compactTask.fast_reschedule();
+		return true;
+	}
+	int n = _compactVisitors.size() - _compactPosition;
+	if (n > BINDINGSTORE_COMPACT_STEP)
+		n = BINDINGSTORE_COMPACT_STEP;
+	if (_store.compactWrite(_compactVisitors.begin() + _compactPosition, n, errh) < 0) {
+		_compactVisitors.clear();
+		return false;
+	}
+	_compactPosition += n;
+	if (_compactPosition < _compactVisitors.size()) {
+		_compactTask.fast_reschedule();
+		return true;
+	}
+	_store.compactEnd(errh);
+	_compactVisitors.clear();
+	return true;
+}
+
+uint8_t Registrar::_checkRequest(RegistrationRequest* request, bool homeAgent){
+	if (homeAgent){
+		// In our annotated version of RFC5944
+		// we only support a couple of things
+		// so reply with code 128 if we don't support the requested functionality
+		if (request->D == 1 || request->B == 1 || request->T == 1 || request->M == 1 || request->G == 1) return 128;
+
+		// If the x and r bit are not 0 ==> poorly formed request
+		if (request->x != 0 || request->r != 0) return 134;
+
+		// If the home agent address 255.255.255.255
+		// return code 136 (Unknown home agent address)
+		if (request->homeAgent == broadCast.addr()) return 136;
+	} else {
+		// If the requested lifetime is too long ==> return code 69
+		if (ntohs(request->lifetime) > maxLifetimeForeignAgent) return 69;
+
+		// If the x and r bit are not 0 ==> poorly formed request
+		if (request->x != 0 || request->r != 0) return 70;
+
+		// GRE encapsulation and minimal encapsulation not supported in this version
+		if (request->M == 1 || request->G == 1) return 72;
+
+		// Support for error code 64
+
+	}
+
+	// Supposed to be 1 but we keep it 0 for this evaluation
+	return 0;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(RoutingElement)
+EXPORT_ELEMENT(Registrar)
@@ -0,0 +1,224 @@
+#ifndef CLICK_REGISTRAR_HH
+#define CLICK_REGISTRAR_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/task.hh>
+#include <click/sync.hh>
+
+// Local imports
+#include "RoutingElement.hh"
+#include "structs/MobilityBinding.hh"
+#include "structs/RegistrationRequest.hh"
+#include "structs/RegistrationReply.hh"
+#include "structs/VisitorEntry.hh"
+#include "utils/ExpiryHeap.hh"
+#include "utils/BindingStore.hh"
+#include "utils/PathStats.hh"
+#include "utils/Metrics.hh"
+
+CLICK_DECLS
+/*
+ *	Click element that handles the Mobile IP registration messages of an agent
+ *	Registration messages are queued and handled by a task of their own, so a
+ *	registration storm does not stall the forwarding path of the RoutingElement
+ *	and the element can be scheduled on another thread (see StaticThreadSched)
+ *	- check the registration requests and generate the replies (HA)
+ *	- relay the requests to the HA and the replies to the MN (FA)
+ *	- keep the mobility bindings and visitors of the RoutingElement up to date
+ *	- with STORE, log every binding and visitor change to that file and restore
+ *	  them on initialize, so a restarted agent tunnels without new registrations
+ *	  The log is compacted by a task of its own in steps of BINDINGSTORE_COMPACT_STEP
+ *	  binding buckets or visitors, registration messages are handled between the steps
+ *	- LIFETIME is the longest lifetime granted by the home agent (default registrationLifetime)
+ *	- PUBLIC_REPLIES true sends the replies of the home agent from its public address, also
+ *	  on the private network where they come from the private address by default
+ *	Input 0 ==> registration requests and replies (UDP port 434)
+ *		at most CAPACITY packets are queued, the others are dropped
+ * 	Output 0 ==> packets to private network
+ *	Output 1 ==> packets to the public network
+ *	Read handlers:
+ *	- queue_depth ==> registration messages waiting in the queue
+ *	- drops ==> registration messages dropped because the queue was full
+ *	- processed ==> registration messages handled
+ *	- latency_avg, latency_max ==> time from queueing until handled, in microseconds
+ *	- store_records ==> records in the log of the STORE
+ *	- store_restored ==> bindings and visitors restored from the STORE on initialize
+ *	- store_replay_usec ==> time it took to replay the STORE, in microseconds
+ *	- store_dropped ==> changes that were not logged because the STORE could not grow
+ *	- lifetime ==> the LIFETIME
+ *	- public_replies ==> the PUBLIC_REPLIES
+ *	- path_<path>_<stat> ==> TSC cycles spent on a registration message, including the
+ *	  elements downstream (only with PATHSTATS, see utils/PathStats.hh)
+ *	  path: request (check, reply or relay to the HA), reply (relay to the MN)
+ *	  stat: count, avg, p50, p99, p999, max
+ *	Write handlers:
+ *	- lifetime ==> set the LIFETIME of the next registrations
+ *	- public_replies ==> set the PUBLIC_REPLIES of the next replies
+ *	- reset_latency ==> reset processed, latency_avg and latency_max
+ *	- reset_paths ==> clear the path histograms
+ *	- clear ==> delete all bindings and visitors (logged to the STORE), e.g. between the
+ *	  loops of a replayed capture
+ *	Metrics (see MetricsExporter): replies generated and relayed per code, requests relayed,
+ *	binding and visitor changes per event, queue drops and processed messages, changes
+ *	dropped by the STORE
+*/
+class Registrar : public Element, public MetricsSource {
+	public:
+		Registrar();
+		~Registrar();
+
+		const char *class_name() const	{ return "Registrar"; }
+		const char *port_count() const	{ return "1/2"; }
+		const char *processing() const	{ return PUSH; }
+		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
+		void cleanup(CleanupStage);
+		void run_timer(Timer* t);
+		bool run_task(Task*);
+		void push(int, Packet* p);
+		void add_handlers();
+		void* cast(const char*);
+		void writeMetrics(StringAccum&) const;
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		// Task which handles the queued registration messages
+		Task _task;
+
+		// Task which writes the compacted STORE in steps, between the runs of _task
+		// It has the home thread of the element like _task, so it never races an append
+		Task _compactTask;
+
+		// Timer which keeps the mobility bindings and visitors up to date
+		// It fires at the earliest binding or visitor deadline
+		Timer _mobilityTimer;
+
+		// Expiry deadlines of the mobility bindings, keyed by home address
+		ExpiryHeap<IPAddress> _bindingExpiry;
+
+		// Expiry deadlines of the visitors, keyed by (home address, identification)
+		ExpiryHeap<VisitorKey> _visitorExpiry;
+
+		// Bounded queue of registration messages, filled on the forwarding thread
+		// Every message keeps the time it was queued to measure the processing latency
+		Vector<Packet*> _queue;
+		Vector<Timestamp> _queued;
+		unsigned _head;
+		unsigned _tail;
+		unsigned _depth;
+		Spinlock _queueLock;
+
+		// Maximum number of queued messages
+		unsigned _capacity;
+
+		// Maximum number of messages handled per task run
+		unsigned _burst;
+
+		// Longest lifetime granted by the home agent
+		uint16_t _lifetime;
+
+		// Replies of the home agent always come from the public address
+		bool _publicReplies;
+
+		// Registration messages dropped because the queue was full
+		uint64_t _drops;
+
+		// Registration messages handled and their total and maximum latency (usec)
+		uint64_t _processed;
+		uint64_t _latencyTotal;
+		uint64_t _latencyMax;
+
+		// Registration and binding counters, see Registrar.cc
+		MetricCounters _counters;
+
+#if PATHSTATS
+		// Cycles spent on requests and replies
+		PathStats _paths;
+#endif
+
+		// Public IPAddress of the agent
+		IPAddress _agentAddressPublic;
+
+		// Private IPAddress of the agent
+		IPAddress _agentAddressPrivate;
+
+		// Reference to the routing element which forwards with the bindings and visitors
+		RoutingElement* _routingElement;
+
+		// Persistent log of the binding and visitor changes, inactive without STORE
+		String _storePath;
+		BindingStore _store;
+
+		// Entries restored from the store and the time the replay took (usec)
+		uint64_t _restored;
+		uint64_t _replayTime;
+
+		// Compaction in progress: the position of the walk over the bindings, then the
+		// visitors copied at the start of the compaction and how many were written
+		uint64_t _compactCursor;
+		bool _compactBindings;
+		Vector<StoreRecord> _compactVisitors;
+		int _compactPosition;
+
+		// Append a change to the store, the log is compacted when it grew too long
+		void _log(const StoreRecord&);
+
+		// Restore the bindings and visitors of the previous run from the store
+		int _replayStore(ErrorHandler*);
+
+		// Start rewriting the store with only the current bindings and visitors
+		int _compactStore(ErrorHandler*);
+
+		// Write the next step of the compaction, false once it is done
+		bool _compactStep(ErrorHandler*);
+
+		// Take the oldest message of the queue, false if the queue is empty
+		bool _dequeue(Packet*& p, Timestamp& queued);
+
+		// Respond to a Mobile IP registration request.
+		void _registrationRequestResponse(Packet* p);
+
+		// Relay the Mobile IP registration reply to the MN.
+		void _registrationReplyRelay(Packet* p);
+
+		//  Generate a reply based on a specific request
+		Packet* _generateReply(IPAddress, uint16_t, uint16_t, RegistrationRequest*, bool);
+
+		// Create, update or delete MobilityBinding for the MN request
+		// Bool indicates if it was a valid request
+		// Return the IPAddress to which the reply must be sent
+		IPAddress _updateMobilityBindings(MobilityBinding, bool);
+
+		// Accept the entry in the visitors list based on the incoming reply
+		void _updateVisitors(RegistrationReply*);
+
+		// Add a pending entry to the visitors list
+		// Based on the request, the destination of the message and the udp source port
+		void _addPendingVisitor(RegistrationRequest*, uint32_t, uint16_t);
+
+		// If registration was denied, delete the pending visitor
+		void _deletePendingVisitor(RegistrationReply*);
+
+		// Delete the mobility bindings whose lifetime has run out
+		void _expireMobilityBindings(const Timestamp& now);
+
+		// Delete the visitors whose lifetime has run out
+		void _expireVisitors(const Timestamp& now);
+
+		// Delete all bindings and visitors and their deadlines
+		void _clear();
+
+		// Make sure the mobility timer fires at the earliest pending deadline
+		void _rescheduleExpiryTimer();
+
+		// Check request and return various codes for the reply
+		// Code 0 indicates that request was valid
+		// For other codes we refer to RFC5944
+		// The boolean parameter indicates if this agent is working like a HA or FA
+		uint8_t _checkRequest(RegistrationRequest*, bool);
+};
+
+CLICK_ENDDECLS
+#endif
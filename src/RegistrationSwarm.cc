@@ -0,0 +1,271 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <clicknet/ether.h>
+#include <clicknet/udp.h>
+#include <clicknet/ip.h>
+
+// Local imports
+#include "RegistrationSwarm.hh"
+#include "structs/RegistrationRequest.hh"
+#include "structs/WireViews.hh"
+#include "utils/Configurables.hh"
+#include "utils/HelperFunctions.hh"
+#include <click/standard/scheduleinfo.hh>
+
+#define SWARM_BURST 32
+
+CLICK_DECLS
+RegistrationSwarm::RegistrationSwarm(): _task(this), _timer(&_task), _nextInitial(0), _careOfAddresses(1), _count(1000), _lifetime(registrationLifetime), _renewPercent(80), _timeout(1000), _active(true), _sent(0), _accepted(0), _denied(0), _timeouts(0), _registered(0){}
+
+RegistrationSwarm::~ RegistrationSwarm(){}
+
+int RegistrationSwarm::configure(Vector<String> &conf, ErrorHandler *errh) {
+	unsigned rate = 1000;
+	unsigned lifetime = _lifetime;
+	if (cp_va_kparse(
+		conf, this, errh,
+		"HA", cpkM, cpIPAddress, &_homeAgent, \
+		"HOME", cpkM, cpIPAddress, &_homePrefix, \
+		"COA", cpkM, cpIPAddress, &_careOfAddress, \
+		"AGENT", cpkN, cpIPAddress, &_agent, \
+		"COUNT", cpkN, cpUnsigned, &_count, \
+		"COAS", cpkN, cpUnsigned, &_careOfAddresses, \
+		"RATE", cpkN, cpUnsigned, &rate, \
+		"LIFETIME", cpkN, cpUnsigned, &lifetime, \
+		"RENEW", cpkN, cpUnsigned, &_renewPercent, \
+		"TIMEOUT", cpkN, cpUnsigned, &_timeout, \
+		"ACTIVE", cpkN, cpBool, &_active, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_count < 1)
+		return errh->error("COUNT must be at least 1");
+	if (_careOfAddresses < 1)
+		return errh->error("COAS must be at least 1");
+	if (rate < 1)
+		return errh->error("RATE must be at least 1");
+	if (lifetime < 1 || lifetime > 0xffff)
+		return errh->error("LIFETIME must be between 1 and 65535");
+	if (_renewPercent < 1 || _renewPercent > 100)
+		return errh->error("RENEW must be between 1 and 100");
+	_lifetime = lifetime;
+	if (!_agent)
+		_agent = _homeAgent;
+	_tokens.assign(rate, rate < 200 ? 2 : rate / 100);
+	return 0;
+}
+
+int RegistrationSwarm::initialize(ErrorHandler *errh) {
+	SwarmNode node;
+	node.identification = 0;
+	node.sequence = 0;
+	node.state = SWARM_IDLE;
+	_nodes.resize(_count, node);
+	ScheduleInfo::initialize_task(this, &_task, errh);
+	_tokens.set(1);
+	_timer.initialize(this);
+	return 0;
+}
+
+bool RegistrationSwarm::run_task(Task*){
+	if (!_active)
+		return false;
+	Timestamp now = Timestamp::now_steady();
+	unsigned count = 0;
+	_tokens.refill();
+	while (count < SWARM_BURST && _tokens.contains(1)) {
+		uint32_t index;
+		Timestamp deadline;
+		if (_deadlines.popExpired(now, index, deadline)) {
+			SwarmNode& node = _nodes[index];
+			// Skip deadlines that were replaced by a reply or a newer request
+			if (node.deadline != deadline || node.state == SWARM_IDLE)
+				continue;
+			if (node.state == SWARM_PENDING)
+				_timeouts++;
+		} else if (_nextInitial < _count)
+			index = _nextInitial++;
+		else
+			break;
+		_tokens.remove(1);
+		_sendRequest(index, now);
+		count++;
+	}
+
+	if (count == SWARM_BURST)
+		_task.fast_reschedule();
+	else if (!_tokens.contains(1))
+		_timer.schedule_after(Timestamp::make_jiffies(_tokens.time_until_contains(1)));
+	else if (!_deadlines.empty())
+		_timer.schedule_at_steady(_deadlines.nextDeadline());
+	return count > 0;
+}
+
+void RegistrationSwarm::_sendRequest(uint32_t index, const Timestamp& now){
+	SwarmNode& node = _nodes[index];
+	IPAddress homeAddress = IPAddress(htonl(ntohl(_homePrefix.addr()) + index + 1));
+	IPAddress careOfAddress = IPAddress(htonl(ntohl(_careOfAddress.addr()) + index % _careOfAddresses));
+
+	int tailroom = 0;
+	int headroom = sizeof(click_ether) + 4;
+	int packetsize = sizeof(click_ip) + sizeof(click_udp) + sizeof(RegistrationRequest);
+	WritablePacket* packet = Packet::make(headroom, 0, packetsize, tailroom);
+	if (!packet)
+		return;
+	memset(packet->data(), 0, packet->length());
+
+	// IP header
+	click_ip *iph = (click_ip *) packet->data();
+	iph->ip_v = 4;
+	iph->ip_hl = sizeof(click_ip) >> 2;
+	iph->ip_len = htons(packet->length());
+	iph->ip_p = IP_PROTO_UDP; // UDP protocol
+	iph->ip_ttl = 64;
+	iph->ip_dst = _agent.in_addr();
+	// Through a foreign agent the node sends from its home address
+	iph->ip_src = _agent == _homeAgent ? careOfAddress.in_addr() : homeAddress.in_addr();
+	iph->ip_sum = click_in_cksum((unsigned char *)iph, sizeof(click_ip));
+	packet->set_dst_ip_anno(_agent);
+	packet->set_ip_header(iph, sizeof(click_ip));
+
+	// UDP header
+	click_udp *udpHeader = (click_udp *) (packet->data() + sizeof(click_ip));
+	udpHeader->uh_sport = htons(portUDP);
+	udpHeader->uh_dport = htons(434);
+	udpHeader->uh_ulen = htons(packet->length() - sizeof(click_ip));
+
+	// Registration request part, the identification holds the node index
+	RegistrationRequest* request = (RegistrationRequest *) (packet->data() + sizeof(click_ip) + sizeof(click_udp));
+	request->type = 1;
+	request->lifetime = htons(_lifetime);
+	request->homeAddress = homeAddress.addr();
+	request->homeAgent = _homeAgent.addr();
+	request->careOfAddress = careOfAddress.addr();
+	node.sequence++;
+	node.identification = ((uint64_t) node.sequence << 32) | index;
+	request->identification = node.identification;
+
+	unsigned csum = click_in_cksum((unsigned char *)udpHeader, sizeof(click_udp) + sizeof(RegistrationRequest));
+	udpHeader->uh_sum = click_in_cksum_pseudohdr(csum, iph, sizeof(click_udp) + sizeof(RegistrationRequest));
+
+	if (node.state == SWARM_REGISTERED)
+		_registered--;
+	node.state = SWARM_PENDING;
+	node.sent = now;
+	node.deadline = now + Timestamp::make_msec(_timeout);
+	_deadlines.schedule(index, node.deadline);
+	_sent++;
+	output(0).push(packet);
+}
+
+void RegistrationSwarm::push(int, Packet* p){
+	const click_ip* iph = (const click_ip*) p->data();
+	RegistrationReplyView reply = RegistrationReplyView::fromPacket(p);
+	if (!reply.valid() || iph->ip_p != IP_PROTO_UDP) {
+		p->kill();
+		return;
+	}
+	uint64_t identification = reply.identification();
+	uint32_t index = (uint32_t) identification;
+	// Only the reply to the outstanding request of a node counts
+	if (reply.type() != 3 || index >= _count || _nodes[index].identification != identification || _nodes[index].state != SWARM_PENDING) {
+		p->kill();
+		return;
+	}
+	SwarmNode& node = _nodes[index];
+	Timestamp now = Timestamp::now_steady();
+	_rtt.add((now - node.sent).usecval());
+	if (reply.code() == 0 || reply.code() == 1) {
+		_accepted++;
+		uint16_t lifetime = reply.lifetime();
+		if (lifetime == 0 || lifetime == 0xffff) {
+			node.state = SWARM_IDLE;
+		} else {
+			node.state = SWARM_REGISTERED;
+			_registered++;
+			node.deadline = now + Timestamp::make_msec((uint64_t) lifetime * 10 * _renewPercent);
+			_deadlines.schedule(index, node.deadline);
+			if (!_task.scheduled() && (!_timer.scheduled() || node.deadline < _timer.expiry_steady()))
+				_timer.schedule_at_steady(node.deadline);
+		}
+	} else {
+		_denied++;
+		node.state = SWARM_IDLE;
+	}
+	p->kill();
+}
+
+enum { H_SENT, H_ACCEPTED, H_DENIED, H_TIMEOUTS, H_REGISTERED, H_RTT_AVG, H_RTT_P50, H_RTT_P90, H_RTT_P99, H_RTT_MAX,
+       H_ACTIVE, H_RESET };
+
+String RegistrationSwarm::read_handler(Element* e, void* thunk){
+	RegistrationSwarm* swarm = (RegistrationSwarm*) e;
+	switch ((intptr_t) thunk) {
+		case H_SENT:
+			return String(swarm->_sent);
+		case H_ACCEPTED:
+			return String(swarm->_accepted);
+		case H_DENIED:
+			return String(swarm->_denied);
+		case H_TIMEOUTS:
+			return String(swarm->_timeouts);
+		case H_REGISTERED:
+			return String(swarm->_registered);
+		case H_RTT_AVG:
+			return String(swarm->_rtt.average());
+		case H_RTT_P50:
+			return String(swarm->_rtt.percentile(50));
+		case H_RTT_P90:
+			return String(swarm->_rtt.percentile(90));
+		case H_RTT_P99:
+			return String(swarm->_rtt.percentile(99));
+		case H_RTT_MAX:
+			return String(swarm->_rtt.max());
+		case H_ACTIVE:
+			return String(swarm->_active);
+		default:
+			return String();
+	}
+}
+
+int RegistrationSwarm::write_handler(const String& input, Element* e, void* thunk, ErrorHandler* errh){
+	RegistrationSwarm* swarm = (RegistrationSwarm*) e;
+	switch ((intptr_t) thunk) {
+		case H_ACTIVE:
+			if (!cp_bool(input, &swarm->_active))
+				return errh->error("active must be a boolean");
+			if (swarm->_active)
+				swarm->_task.reschedule();
+			return 0;
+		case H_RESET:
+			swarm->_sent = 0;
+			swarm->_accepted = 0;
+			swarm->_denied = 0;
+			swarm->_timeouts = 0;
+			swarm->_rtt.clear();
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void RegistrationSwarm::add_handlers(){
+	add_read_handler("sent", read_handler, H_SENT);
+	add_read_handler("accepted", read_handler, H_ACCEPTED);
+	add_read_handler("denied", read_handler, H_DENIED);
+	add_read_handler("timeouts", read_handler, H_TIMEOUTS);
+	add_read_handler("registered", read_handler, H_REGISTERED);
+	add_read_handler("rtt_avg", read_handler, H_RTT_AVG);
+	add_read_handler("rtt_p50", read_handler, H_RTT_P50);
+	add_read_handler("rtt_p90", read_handler, H_RTT_P90);
+	add_read_handler("rtt_p99", read_handler, H_RTT_P99);
+	add_read_handler("rtt_max", read_handler, H_RTT_MAX);
+	add_read_handler("active", read_handler, H_ACTIVE);
+	add_write_handler("active", write_handler, H_ACTIVE);
+	add_write_handler("reset", write_handler, H_RESET, Handler::BUTTON);
+	add_task_handlers(&_task);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(RegistrationSwarm)
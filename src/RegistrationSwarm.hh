@@ -0,0 +1,104 @@
+#ifndef CLICK_REGISTRATIONSWARM_HH
+#define CLICK_REGISTRATIONSWARM_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/task.hh>
+#include <click/tokenbucket.hh>
+
+// Local imports
+#include "utils/ExpiryHeap.hh"
+#include "utils/LatencyHistogram.hh"
+
+CLICK_DECLS
+
+/*
+ *	Click element that emulates COUNT mobile nodes registering with one home agent
+ *	It is a load generator to size a home agent, not a mobile node implementation
+ *	- mobile node i has home address HOME + i + 1 and care of address COA + (i % COAS)
+ *	- every node registers once, then renews after RENEW percent of the granted lifetime
+ *	- requests are sent to HA from the (co-located) care of address at RATE requests per second
+ *	- with AGENT, requests are sent from the home address to that foreign agent, which relays
+ *	  them to HA, so the foreign agent learns the nodes as visitors (COA is then its address)
+ *	- a request without reply after TIMEOUT milliseconds is sent again
+ *	- replies are matched on their identification, which holds the index of the node
+ *	Input 0 ==> registration replies
+ *	Output 0 ==> registration requests
+ *	Read handlers:
+ *	- sent, accepted, denied, timeouts ==> request and reply counts
+ *	- registered ==> nodes with an accepted registration
+ *	- rtt_avg, rtt_p50, rtt_p90, rtt_p99, rtt_max ==> request to reply time, in microseconds
+ *	Write handlers:
+ *	- active ==> start (true) or pause (false) sending requests
+ *	- reset ==> reset the counts and the RTT histogram
+*/
+class RegistrationSwarm : public Element {
+	public:
+		RegistrationSwarm();
+		~RegistrationSwarm();
+
+		const char *class_name() const	{ return "RegistrationSwarm"; }
+		const char *port_count() const	{ return "1/1"; }
+		const char *processing() const	{ return PUSH; }
+		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
+		bool run_task(Task*);
+		void push(int, Packet* p);
+		void add_handlers();
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		enum SwarmState { SWARM_IDLE, SWARM_PENDING, SWARM_REGISTERED };
+
+		// State of one emulated mobile node
+		struct SwarmNode {
+			uint64_t identification;
+			Timestamp sent;
+			// Deadline of the retransmission or renewal of this node
+			Timestamp deadline;
+			uint32_t sequence;
+			uint8_t state;
+		};
+
+		// Task which sends the requests
+		Task _task;
+
+		// Wakes the task up when tokens or deadlines are due
+		Timer _timer;
+
+		// Limits the request rate to RATE
+		TokenBucket _tokens;
+
+		// Retransmissions and renewals, keyed by node index
+		ExpiryHeap<uint32_t> _deadlines;
+
+		Vector<SwarmNode> _nodes;
+
+		// Index of the next node that has not registered yet
+		uint32_t _nextInitial;
+
+		IPAddress _homeAgent;
+		IPAddress _agent;
+		IPAddress _homePrefix;
+		IPAddress _careOfAddress;
+		uint32_t _careOfAddresses;
+		uint32_t _count;
+		uint16_t _lifetime;
+		unsigned _renewPercent;
+		unsigned _timeout;
+		bool _active;
+
+		uint64_t _sent;
+		uint64_t _accepted;
+		uint64_t _denied;
+		uint64_t _timeouts;
+		uint64_t _registered;
+		LatencyHistogram _rtt;
+
+		// Send a new registration request for node index
+		void _sendRequest(uint32_t index, const Timestamp& now);
+};
+
+CLICK_ENDDECLS
+#endif
@@ -11,8 +11,11 @@
 #include "RequestGenerator.hh"
 #include "structs/RegistrationRequest.hh"
 #include "utils/Configurables.hh"
+#include "utils/EventTrace.hh"
 #include "utils/HelperFunctions.hh"
 
+enum { C_REGISTRATIONS, C_DEREGISTRATIONS, C_END };
+
 CLICK_DECLS
 RequestGenerator::RequestGenerator():_timer(this){}
 
@@ -24,6 +27,7 @@ int RequestGenerator::configure(Vector<String> &conf, ErrorHandler *errh) {
 			return -1;
 	}
 	_timer.initialize(this);
+	_counters.initialize(C_END);
 	return 0;
 }
 
@@ -72,6 +76,15 @@ uint64_t RequestGenerator::getActiveRegistrationID(IPAddress dest) {
 	return 0;
 }
 
+Timestamp RequestGenerator::getRequestSent(uint64_t identification) {
+	for (Vector<RegistrationData>::iterator it=_pendingRegistrationsData.begin(); it != _pendingRegistrationsData.end(); it++){
+		if (it->identification == identification){
+			return it->sent;
+		}
+	}
+	return Timestamp();
+}
+
 void RequestGenerator::setValid(bool newValid) {
 	valid = newValid;
 }
@@ -141,6 +154,7 @@ void RequestGenerator::generateRequest(IPAddress agentAddress, IPAddress coa, ui
 	data.identification = request->identification;
 	data.originalLifetime = ntohs(request->lifetime);
 	data.remainingLifetime = ntohs(request->lifetime);
+	data.sent = Timestamp::now_steady();
 	_manageRegistrations(data);
 
 	// If timer not yet scheduled ==> schedule it
@@ -150,9 +164,22 @@ void RequestGenerator::generateRequest(IPAddress agentAddress, IPAddress coa, ui
 	LOG("[RequestGenerator] Sent a request with id %d", request->identification);
 
 	// Push the packet to the private network
+	_counters.add(lifetime == 0 ? C_DEREGISTRATIONS : C_REGISTRATIONS);
+	TRACE_EVENT(this, TRACE_REGISTRATION_SENT, _srcAddress.addr(), agentAddress.addr(), request->identification, lifetime);
 	output(0).push(packet);
 }
 
+void* RequestGenerator::cast(const char* name){
+	if (strcmp(name, "MetricsSource") == 0)
+		return static_cast<MetricsSource*>(this);
+	return Element::cast(name);
+}
+
+void RequestGenerator::writeMetrics(StringAccum& sa) const {
+	writeMetric(sa, this, "registration_requests_sent_total", _counters.value(C_REGISTRATIONS), "lifetime=\"nonzero\"");
+	writeMetric(sa, this, "registration_requests_sent_total", _counters.value(C_DEREGISTRATIONS), "lifetime=\"zero\"");
+}
+
 void RequestGenerator::_decreaseRemainingLifetime(){
 	for (int it=0; it<_pendingRegistrationsData.size(); it++){
 		click_chatter("[RequestGenerator] Registration expires in %d seconds", _pendingRegistrationsData.at(it).remainingLifetime);
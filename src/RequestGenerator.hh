@@ -5,6 +5,7 @@
 
 // Local imports
 #include "structs/RegistrationData.hh"
+#include "utils/Metrics.hh"
 
 CLICK_DECLS
 
@@ -12,8 +13,9 @@ CLICK_DECLS
  *	Click element that will generate requests at the mobile node
  *	Mobile node will send requests when he has determined that his current agent is no longer online
  *  or if the mobile node has moved to a foreign network
+ *	Metrics (see MetricsExporter): registration requests sent, deregistrations (lifetime 0) apart
 */
-class RequestGenerator : public Element {
+class RequestGenerator : public Element, public MetricsSource {
 	public:
 		RequestGenerator();
 		~RequestGenerator();
@@ -23,6 +25,8 @@ class RequestGenerator : public Element {
 		const char *processing() const	{ return PUSH; }
 		int configure(Vector<String>&, ErrorHandler*);
 		void run_timer(Timer* t);
+		void* cast(const char*);
+		void writeMetrics(StringAccum&) const;
 
 		// Generate a registration request and push it to output 0
     		void generateRequest(IPAddress agentAddress, IPAddress coa, uint16_t);
@@ -38,6 +42,9 @@ class RequestGenerator : public Element {
 
 		uint64_t getActiveRegistrationID(IPAddress);
 
+		// Time the request with this identification was sent, zero if it is not pending
+		Timestamp getRequestSent(uint64_t);
+
 		void setValid(bool);
 		bool getValid();
 
@@ -56,13 +63,12 @@ class RequestGenerator : public Element {
 
 		bool valid = false;
 
+		// Requests sent, counted per thread
+		MetricCounters _counters;
+
 		// Vector of datastructs with information about the pending registrations
 		Vector<RegistrationData> _pendingRegistrationsData;
 
-		// Vector of potential agents
-		// The generator will use the first IP address of the vector as destination address of its request message
-		Vector<IPAddress> _potentialAgents;
-
 		// Private methods
 		// Update the remainingLifetime field of each elemenet in the pendingRegistrationsData vector
 		void _decreaseRemainingLifetime();
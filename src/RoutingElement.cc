@@ -9,59 +9,221 @@
 #include "RoutingElement.hh"
 #include "utils/Configurables.hh"
 #include "utils/HelperFunctions.hh"
+#include <click/standard/scheduleinfo.hh>
+
+#define MAX_BURST 64
+
+#if PATHSTATS
+// Paths timed with PATHSTATS
+enum { PATH_CN, PATH_SOLICITATION, PATH_DECAP, PATH_REGISTRATION, PATH_END };
+static const char* const pathNames[] = { "cn", "solicitation", "decap", "registration" };
+#endif
+
+// Counters of the forwarding paths
+enum { C_TUNNEL_HITS, C_TUNNEL_MISSES, C_TUNNEL_FALLTHROUGH, C_ENCAP_BYTES, C_DECAPSULATED,
+       C_DECAP_DROPPED, C_DECAP_MALFORMED, C_DECAP_BYTES, C_SOLICITATIONS, C_SOLICITATIONS_INVALID,
+       C_REGISTRATION_MESSAGES, C_LOCAL, C_END };
 
 CLICK_DECLS
-RoutingElement::RoutingElement(): _mobilityTimer(this){}
+RoutingElement::RoutingElement(): _task(this), _burst(32){}
 
 RoutingElement::~ RoutingElement(){}
 
 int RoutingElement::configure(Vector<String> &conf, ErrorHandler *errh) {
+	unsigned shards = 1;
 	if (cp_va_kparse(
 		conf, this, errh,
 	        "PUBLIC", cpkM, cpIPAddress, &_agentAddressPublic, \
 		"PRIVATE", cpkM, cpIPAddress, &_agentAddressPrivate, \
 		"ADVERTISER", cpkM, (Advertiser*) cpElement, &_advertiser, \
+		"BURST", cpkN, cpUnsigned, &_burst, \
+		"SHARDS", cpkN, cpUnsigned, &shards, \
 		cpEnd) < 0) {
 			return -1;
 	}
+	if (shards < 1)
+		return errh->error("SHARDS must be at least 1");
+	_mobilityBindings.setShards(shards);
+	if (_burst < 1 || _burst > MAX_BURST)
+		return errh->error("BURST must be between 1 and %d", MAX_BURST);
+	_counters.initialize(C_END);
 	return 0;
 }
 
-int RoutingElement::initialize(ErrorHandler *) {
-	// Initialize timer object
-	_mobilityTimer.initialize(this);
-	_mobilityTimer.schedule_now();
+int RoutingElement::initialize(ErrorHandler *errh) {
+	_reader = _mobilityBindings.addReader();
+#if PATHSTATS
+	_paths.initialize(PATH_END);
+#endif
+	// Batched mode, only when the CN input is pulled
+	if (input_is_pull(1)) {
+		ScheduleInfo::initialize_task(this, &_task, errh);
+		_signal = Notifier::upstream_empty_signal(this, 1, &_task);
+	}
 	return 0;
 }
 
-void RoutingElement::run_timer(Timer* t){
-	if (t == &_mobilityTimer){
-		_decreaseLifetimeMobilityBindings();
-		_decreaseLifetimeVisitors();
-		t->reschedule_after_sec(1);
+enum { H_TUNNEL_HITS, H_TUNNEL_MISSES, H_TUNNEL_FALLTHROUGH, H_BINDINGS,
+       H_DECAP_PACKETS, H_DECAP_DROPPED, H_DECAP_MALFORMED, H_VISITORS,
+       H_VISITORS_PENDING, H_VISITORS_EVICTED, H_BURST, H_RESET_PATHS, H_PATHS };
+
+bool RoutingElement::run_task(Task*){
+	Packet* batch[MAX_BURST];
+	const MobilityBinding* bindings[MAX_BURST];
+	unsigned count = 0;
+	while (count < _burst) {
+		Packet* p = input(1).pull();
+		if (!p)
+			break;
+		batch[count++] = p;
+	}
+	if (!count) {
+		if (_signal)
+			_task.fast_reschedule();
+		return false;
+	}
+	PATHSTATS_START(start);
+
+	// Look up the bindings of the whole batch first and prefetch the tunnel headers
+	_mobilityBindings.readBegin(_reader);
+	bool bindingsEmpty = _mobilityBindings.empty();
+	for (unsigned i = 0; i < count; i++) {
+		bindings[i] = 0;
+		if (!bindingsEmpty) {
+			const click_ip* iph = (const click_ip*) batch[i]->data();
+			bindings[i] = _mobilityBindings.lookup(IPAddress(iph->ip_dst));
+			if (bindings[i])
+				__builtin_prefetch(&bindings[i]->tunnelHeader);
+		}
+	}
+
+	// Encapsulate and forward the batch
+	for (unsigned i = 0; i < count; i++)
+		_forwardCorrespondent(batch[i], bindings[i]);
+	_mobilityBindings.readEnd(_reader);
+	// One sample per packet: the average cost of the packets of the batch
+	PATHSTATS_RECORD_BATCH(_paths, PATH_CN, start, count);
+
+	if (count == _burst || _signal)
+		_task.fast_reschedule();
+	return count > 0;
+}
+
+String RoutingElement::read_handler(Element* e, void* thunk){
+	RoutingElement* routingElement = (RoutingElement*) e;
+	switch ((intptr_t) thunk) {
+		case H_TUNNEL_HITS:
+			return String(routingElement->_counters.value(C_TUNNEL_HITS));
+		case H_TUNNEL_MISSES:
+			return String(routingElement->_counters.value(C_TUNNEL_MISSES));
+		case H_TUNNEL_FALLTHROUGH:
+			return String(routingElement->_counters.value(C_TUNNEL_FALLTHROUGH));
+		case H_BINDINGS:
+			return String(routingElement->_mobilityBindings.size());
+		case H_DECAP_PACKETS:
+			return String(routingElement->_counters.value(C_DECAPSULATED));
+		case H_DECAP_DROPPED:
+			return String(routingElement->_counters.value(C_DECAP_DROPPED));
+		case H_DECAP_MALFORMED:
+			return String(routingElement->_counters.value(C_DECAP_MALFORMED));
+		case H_VISITORS:
+			return String(routingElement->_visitors.size());
+		case H_VISITORS_PENDING:
+			return String(routingElement->_visitors.pending());
+		case H_VISITORS_EVICTED:
+			return String(routingElement->_visitors.evicted());
+		case H_BURST:
+			return String(routingElement->_burst);
+		default:
+#if PATHSTATS
+			if ((intptr_t) thunk >= H_PATHS) {
+				int path = ((intptr_t) thunk - H_PATHS) / HISTOGRAM_STATS;
+				int stat = ((intptr_t) thunk - H_PATHS) % HISTOGRAM_STATS;
+				return String(routingElement->_paths.stat(path, stat));
+			}
+#endif
+			return String();
+	}
+}
+
+void* RoutingElement::cast(const char* name){
+	if (strcmp(name, "MetricsSource") == 0)
+		return static_cast<MetricsSource*>(this);
+	return Element::cast(name);
+}
+
+void RoutingElement::writeMetrics(StringAccum& sa) const {
+	writeMetric(sa, this, "cn_packets_total", _counters.value(C_TUNNEL_HITS), "result=\"tunneled\"");
+	writeMetric(sa, this, "cn_packets_total", _counters.value(C_TUNNEL_MISSES), "result=\"miss\"");
+	writeMetric(sa, this, "cn_packets_total", _counters.value(C_TUNNEL_FALLTHROUGH), "result=\"fallthrough\"");
+	writeMetric(sa, this, "encapsulated_bytes_total", _counters.value(C_ENCAP_BYTES));
+	writeMetric(sa, this, "decap_packets_total", _counters.value(C_DECAPSULATED), "result=\"forwarded\"");
+	writeMetric(sa, this, "decap_packets_total", _counters.value(C_DECAP_DROPPED), "result=\"dropped\"");
+	writeMetric(sa, this, "decap_packets_total", _counters.value(C_DECAP_MALFORMED), "result=\"malformed\"");
+	writeMetric(sa, this, "decapsulated_bytes_total", _counters.value(C_DECAP_BYTES));
+	writeMetric(sa, this, "solicitations_received_total", _counters.value(C_SOLICITATIONS), "result=\"valid\"");
+	writeMetric(sa, this, "solicitations_received_total", _counters.value(C_SOLICITATIONS_INVALID), "result=\"invalid\"");
+	writeMetric(sa, this, "registration_messages_total", _counters.value(C_REGISTRATION_MESSAGES));
+	writeMetric(sa, this, "local_packets_total", _counters.value(C_LOCAL));
+	writeMetric(sa, this, "bindings", _mobilityBindings.size());
+	writeMetric(sa, this, "visitors", _visitors.size());
+	writeMetric(sa, this, "visitors_pending", _visitors.pending());
+}
+
+int RoutingElement::write_handler(const String& input, Element* e, void* thunk, ErrorHandler* errh){
+	RoutingElement* routingElement = (RoutingElement*) e;
+	unsigned value;
+	switch ((intptr_t) thunk) {
+		case H_BURST:
+			if (!cp_integer(input, &value) || value < 1 || value > MAX_BURST)
+				return errh->error("burst must be between 1 and %d", MAX_BURST);
+			routingElement->_burst = value;
+			return 0;
+#if PATHSTATS
+		case H_RESET_PATHS:
+			routingElement->_paths.clear();
+			return 0;
+#endif
+		default:
+			return -1;
 	}
 }
 
+void RoutingElement::add_handlers(){
+	add_read_handler("tunnel_hits", read_handler, H_TUNNEL_HITS);
+	add_read_handler("tunnel_misses", read_handler, H_TUNNEL_MISSES);
+	add_read_handler("tunnel_fallthrough", read_handler, H_TUNNEL_FALLTHROUGH);
+	add_read_handler("bindings", read_handler, H_BINDINGS);
+	add_read_handler("decap_packets", read_handler, H_DECAP_PACKETS);
+	add_read_handler("decap_dropped", read_handler, H_DECAP_DROPPED);
+	add_read_handler("decap_malformed", read_handler, H_DECAP_MALFORMED);
+	add_read_handler("visitors", read_handler, H_VISITORS);
+	add_read_handler("visitors_pending", read_handler, H_VISITORS_PENDING);
+	add_read_handler("visitors_evicted", read_handler, H_VISITORS_EVICTED);
+	add_read_handler("burst", read_handler, H_BURST);
+	add_write_handler("burst", write_handler, H_BURST);
+#if PATHSTATS
+	for (int path = 0; path < PATH_END; path++)
+		for (int stat = 0; stat < HISTOGRAM_STATS; stat++)
+			add_read_handler(String("path_") + pathNames[path] + "_" + LatencyHistogram::statName(stat), read_handler, H_PATHS + path * HISTOGRAM_STATS + stat);
+	add_write_handler("reset_paths", write_handler, H_RESET_PATHS, Handler::BUTTON);
+#endif
+}
+
 void RoutingElement::push(int port, Packet* p){
 	click_ip* iph = (click_ip*) p->data();
 
 	// Delivery to own ipnet
 	if (port == 1){
 		// Message from corresponding node
-		if (_mobilityBindings.empty()) {
-			// Mobile node at home
-			LOG("[RoutingElement] Mobile Node is at home");
-			// sending to local network.
-			output(0).push(p);
-		} else {
-			// Mobile node is away
-			LOG("[RoutingElement] Mobile Node is away");
-			IPAddress dstAddress = iph->ip_dst;
-			IPAddress tunnelEndpoint = _findCareOfAddress(dstAddress);
-			LOG("Tunnel endpoint %s", tunnelEndpoint.unparse().c_str());
-			// IP in IP encapsulate and send it to the public network
-			_encapIPinIP(p, tunnelEndpoint);
-		}
+		PATHSTATS_START(start);
+		_mobilityBindings.readBegin(_reader);
+		const MobilityBinding* binding = 0;
+		if (!_mobilityBindings.empty())
+			binding = _mobilityBindings.lookup(IPAddress(iph->ip_dst));
+		_forwardCorrespondent(p, binding);
+		_mobilityBindings.readEnd(_reader);
+		PATHSTATS_RECORD(_paths, PATH_CN, start);
 		return;
 	}
 
@@ -70,41 +232,64 @@ void RoutingElement::push(int port, Packet* p){
 		case 1:
 			// Solicitation message
 			{
+				PATHSTATS_START(start);
 				_solicitationResponse(p);
-				p->kill();
+				PATHSTATS_RECORD(_paths, PATH_SOLICITATION, start);
 				return;
 			}
 		case 4:
 			// IP in IP
 			{
-				// Decapsulate packet
-				p->pull(sizeof(click_ip));
-				// Forward to mobile node.
-				click_ip* ipHeader = (click_ip*) p->data();
-				p->set_dst_ip_anno(IPAddress(ipHeader->ip_dst));
-				output(0).push(p);
+				PATHSTATS_START(start);
+				_decapIPinIP(p);
+				PATHSTATS_RECORD(_paths, PATH_DECAP, start);
+				return;
 			}
 		case 17:
 			// Mobile IP Registration
 			{
 				click_udp* udpHeader = (click_udp*) (p->data() + sizeof(click_ip));
-				uint16_t destinationPort = ntohs(udpHeader->uh_dport);
-				uint16_t sourcePort = ntohs(udpHeader-> uh_sport);
-				if (destinationPort == 434) {
-					// Registration request
-					_registrationRequestResponse(p);
-				}
-				else if (sourcePort == 434) {
-					// Registration reply relayed to the mobile node
-					_registrationReplyRelay(p);
+				if (ntohs(udpHeader->uh_dport) == 434 || ntohs(udpHeader->uh_sport) == 434) {
+					// Handled by the Registrar, off the forwarding path
+					PATHSTATS_START(start);
+					_counters.add(C_REGISTRATION_MESSAGES);
+					output(3).push(p);
+					PATHSTATS_RECORD(_paths, PATH_REGISTRATION, start);
+					return;
 				}
+				_counters.add(C_LOCAL);
+				output(2).push(p);
 				return;
 			}
 		default:
+			_counters.add(C_LOCAL);
 			output(2).push(p);
 	}
 }
 
+void RoutingElement::_forwardCorrespondent(Packet* p, const MobilityBinding* binding){
+	if (_mobilityBindings.empty()) {
+		// No mobile node is away, sending to local network.
+		_counters.add(C_TUNNEL_FALLTHROUGH);
+		output(0).push(p);
+		return;
+	}
+	// Only destinations with an active binding are tunneled
+	if (!binding) {
+		// Mobile node at home
+		LOG("[RoutingElement] Mobile Node is at home");
+		_counters.add(C_TUNNEL_MISSES);
+		output(0).push(p);
+		return;
+	}
+	// Mobile node is away
+	LOG("[RoutingElement] Mobile Node is away");
+	LOG("Tunnel endpoint %s", IPAddress(binding->careOfAddress).unparse().c_str());
+	_counters.add(C_TUNNEL_HITS);
+	// IP in IP encapsulate and send it to the public network
+	_encapIPinIP(p, *binding);
+}
+
 void RoutingElement::_solicitationResponse(Packet* p) {
 	LOG("[RoutingElement] Solicitation response received");
 	click_ip* iph = (click_ip*) p->data();
@@ -116,375 +301,85 @@ void RoutingElement::_solicitationResponse(Packet* p) {
 		LOGERROR("[RoutingElement] Solicitation message is "
 		 	 "sent with code %d but it should be 0",
 			 solicitation->code);
+		_counters.add(C_SOLICITATIONS_INVALID);
 	}
 	else if (icmp_len < 8){
 		LOGERROR("[RoutingElement] Solicitation message is "
 			 "sent with length %d which is not 8 or more octets",
 			 ntohs(iph->ip_len) - sizeof(click_ip));
+		_counters.add(C_SOLICITATIONS_INVALID);
 	}
 	else if (csum != 0){
 		LOGERROR("[RoutingElement] Solicitation message is "
 			 "sent with an invalid checksum");
+		_counters.add(C_SOLICITATIONS_INVALID);
 	}
 	else if (solicitation->type == 10){
-		_advertiser->respondToSolicitation();
+		_counters.add(C_SOLICITATIONS);
+		_advertiser->respondToSolicitation(p);
 	}
 	p->kill();
 	return;
 }
 
-// Relay on output port 1
-// Reply on port 3 private/4 public.
-void RoutingElement::_registrationRequestResponse(Packet* p) {
-	click_ip* iph = (click_ip*) p->data();
-	uint32_t dstAddressRequest = ntohl(IPAddress(iph->ip_dst).addr());
-	click_udp* udpHeader = (click_udp*) (p->data() + sizeof(click_ip));
-	LOG("[RoutingElement] Received a registration request at agent side");
-	RegistrationRequest* request =
-	(RegistrationRequest*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
-	// If the request is for another agent
-	if (request->homeAgent != _agentAddressPublic.addr()){
-		// Relay the registration request to port 1
-		LOG("[RoutingElement] Received a request not for the agent itself, relaying it");
-		iph->ip_src = _agentAddressPublic.in_addr();
-		iph->ip_dst = IPAddress(request->homeAgent).in_addr();
-		iph->ip_len = htons(p->length());
-		p->set_dst_ip_anno(IPAddress(iph->ip_dst));
-		// FA needs to check incoming requests and
-		// generate possible replies to it (see chapter 3.3)
-		// If incoming request at the FA is invalid ==> send reply immediately
-		RegistrationRequest* request =
-		(RegistrationRequest*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
-		if (_checkRequest(request, false) != 1 &&
-		    _checkRequest(request, false) != 0) {
-			LOGERROR("[RoutingElement] FA received an invalid request, "
-			 	 "error code %d", _checkRequest(request, false));
-			Packet* reply = _generateReply(IPAddress(request->homeAddress),
-						       udpHeader->uh_dport,
-						       udpHeader->uh_sport,
-						       request,
-					       	       false);
-			p->kill();
-			output(0).push(reply);
-			return;
-		}
-
-		// Request was valid so add entry in the visitors list
-		uint16_t udpPort = ntohs(udpHeader->uh_sport);
-		_addPendingVisitor(request, dstAddressRequest, udpPort);
-
-		// Set the UDP header checksum based on the initialized values
-		//unsigned csum = click_in_cksum((unsigned char *)udpHeader, sizeof(click_udp) + sizeof(RegistrationRequest));
-		//udpHeader->uh_sum = click_in_cksum_pseudohdr(csum, iph, sizeof(click_udp) + sizeof(RegistrationRequest));
-		output(1).push(p);
-		return;
+void RoutingElement::_encapIPinIP(Packet* p, const MobilityBinding& binding){
+	if (WritablePacket* newPacket = encapIPinIP(p, binding)) {
+		_counters.add(C_ENCAP_BYTES, newPacket->length());
+		output(1).push(newPacket);
 	}
-	// If the request is for the agent itself or 255.255.255.255
-	if (request->homeAgent == _agentAddressPublic.addr() || request->homeAgent == broadCast.addr()){
-		// Handle the registration request
-		LOG("[RoutingElement] Received a request for the agent itself, don't relay");
-		RegistrationRequest* request =
-		(RegistrationRequest*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
-
-		uint8_t replyCode = _checkRequest(request, true);
-		bool validRequest = (replyCode == 1 || replyCode == 0);
-		MobilityBinding mobilityData;
-		mobilityData.homeAddress = request->homeAddress;
-		mobilityData.careOfAddress = request->careOfAddress;
-		mobilityData.lifetime = ntohs(request->lifetime);
-		mobilityData.replyIdentification = request->identification;
-		IPAddress replyDestination = _updateMobilityBindings(mobilityData, validRequest);
-
-		// Generate the reply
-		Packet* replyPacket = _generateReply(replyDestination,
-						     udpHeader->uh_dport,
-						     udpHeader->uh_sport,
-						     request, true);
+}
 
-		// Kill the request packet
+void RoutingElement::_decapIPinIP(Packet* p){
+	const click_ip* outerIP = (const click_ip*) p->data();
+	unsigned outerLength = outerIP->ip_hl << 2;
+	// The outer header must be followed by a complete inner IPv4 header (RFC2003)
+	if (outerLength < sizeof(click_ip) || p->length() < outerLength + sizeof(click_ip)) {
+		LOGERROR("[RoutingElement] Received IP in IP packet that is too short");
+		_counters.add(C_DECAP_MALFORMED);
 		p->kill();
-
-		// Push reply
-		if (sameNetwork(replyPacket->dst_ip_anno(), _agentAddressPrivate)){
-			LOG("[RoutingElement] Pushing reply to local network");
-			output(0).push(replyPacket);
-			return;
-		}
-		output(1).push(replyPacket);
 		return;
 	}
-}
-
-// Relay the registration reply on the private network (to the MN)
-void RoutingElement::_registrationReplyRelay(Packet* p) {
-	click_ip* iph = (click_ip*) p->data();
-	click_udp* udpHeader = (click_udp*) (p->data() + sizeof(click_ip));
-	LOG("[RoutingElement] Received a reply message at agent side, forwarding to MN");
-	RegistrationReply* reply =
-	(RegistrationReply*) (p->data() + sizeof(click_ip) + sizeof(click_udp));
-	// Check if port is corresponding with the port used in the request
-	VisitorEntry entry;
-	bool poorlyFormed = !_findVisitorEntry(reply, entry);
-	if (poorlyFormed) {
-		LOGERROR("[RoutingElement] Received registration reply packet that is poorly formed");
-		reply->code = 71;
-		_deletePendingVisitor(reply);
-		iph->ip_src = _agentAddressPrivate.in_addr();
-		iph->ip_dst = IPAddress(reply->homeAddress).in_addr();
-		iph->ip_len = htons(p->length());
-		p->set_dst_ip_anno(IPAddress(iph->ip_dst));
-		output(0).push(p);
+	const click_ip* innerIP = (const click_ip*) (p->data() + outerLength);
+	unsigned innerLength = innerIP->ip_hl << 2;
+	if (innerIP->ip_v != 4 || innerLength < sizeof(click_ip) ||
+	    ntohs(innerIP->ip_len) < innerLength || ntohs(innerIP->ip_len) > p->length() - outerLength) {
+		LOGERROR("[RoutingElement] Received IP in IP packet with a malformed inner header");
+		_counters.add(C_DECAP_MALFORMED);
+		p->kill();
 		return;
 	}
-	if (entry.udpSourcePort != ntohs(udpHeader->uh_dport)){
-		LOGERROR("[RoutingElement] Received registration reply packet on UDP port %d, but expected port %d", ntohs(udpHeader->uh_dport), entry.udpSourcePort);
-		_deletePendingVisitor(reply);
+	// Only decapsulate for visitors that registered through this home agent
+	// A packet for the decapsulator itself would loop and is dropped as well
+	bool knownVisitor = _visitors.isVisitor(ntohl(innerIP->ip_dst.s_addr), ntohl(outerIP->ip_src.s_addr));
+	if (!knownVisitor || IPAddress(innerIP->ip_dst) == _agentAddressPublic || IPAddress(innerIP->ip_dst) == _agentAddressPrivate) {
+		LOGERROR("[RoutingElement] Dropped IP in IP packet for %s from %s",
+			 IPAddress(innerIP->ip_dst).unparse().c_str(),
+			 IPAddress(outerIP->ip_src).unparse().c_str());
+		_counters.add(C_DECAP_DROPPED);
 		p->kill();
 		return;
 	}
-	if (!poorlyFormed && (reply->code == 1 || reply->code == 0))
-		_updateVisitors(reply);
-	if (reply->code != 0 && reply->code != 1)
-		_deletePendingVisitor(reply);
-	iph->ip_src = _agentAddressPrivate.in_addr();
-	iph->ip_dst = IPAddress(reply->homeAddress).in_addr();
-	iph->ip_len = htons(p->length());
-	p->set_dst_ip_anno(IPAddress(iph->ip_dst));
-	output(0).push(p);
-}
-
-void RoutingElement::_encapIPinIP(Packet* p, IPAddress careOfAddress){
-	click_ip* innerIP = (click_ip *) p->data();
-	innerIP->ip_ttl++;
-	innerIP->ip_sum = 0;
-	innerIP->ip_sum = click_in_cksum((unsigned char *)innerIP, sizeof(click_ip));
-	p->set_ip_header(innerIP, sizeof(click_ip));
-	// Create new packet with place for outer IP header
-	WritablePacket* newPacket = p->push(sizeof(click_ip));
-	click_ip* outerIP = reinterpret_cast<click_ip *>(newPacket->data());;
-	outerIP->ip_v = 4;
-	outerIP->ip_hl = sizeof(click_ip) >> 2;
-	outerIP->ip_p = 4;
-	outerIP->ip_off = 0;
-	outerIP->ip_tos = innerIP->ip_tos;
-	outerIP->ip_len = htons(newPacket->length());
-	outerIP->ip_ttl = 64;
-	outerIP->ip_src = _agentAddressPublic.in_addr();
-	outerIP->ip_dst = careOfAddress.in_addr();
-	outerIP->ip_sum = click_in_cksum((unsigned char *)outerIP, sizeof(click_ip));
-	newPacket->set_dst_ip_anno(IPAddress(outerIP->ip_dst));
-	newPacket->set_ip_header(outerIP, sizeof(click_ip));
-	output(1).push(newPacket);
-}
-
-Packet* RoutingElement::_generateReply(IPAddress dstAddress, uint16_t srcPort, uint16_t dstPort, RegistrationRequest* request, bool homeAgent){
-	LOG("[RoutingElement] Reply to MobileIP request message");
-	int tailroom = 0;
-	int headroom = sizeof(click_ether) + 4;
-	int packetsize = sizeof(click_ip) + sizeof(click_udp) + sizeof(RegistrationReply);
-	WritablePacket* packet = Packet::make(headroom, 0, packetsize, tailroom);
-	memset(packet->data(), 0, packet->length());
-
-	// IP header
-	click_ip *iph = (click_ip *) packet->data();
-	iph->ip_v = 4;
-	iph->ip_hl = sizeof(click_ip) >> 2;
-	iph->ip_len = htons(packet->length());
-	iph->ip_id = htons(0);
-	iph->ip_p = IP_PROTO_UDP; // UDP protocol
-	iph->ip_tos = 0x00;
-	iph->ip_ttl = 64;
-	iph->ip_dst = dstAddress.in_addr();
-	iph->ip_src = _agentAddressPublic.in_addr();
-	if (sameNetwork(_agentAddressPrivate, dstAddress))
-		iph->ip_src = _agentAddressPrivate.in_addr();
-
-	iph->ip_sum = 0;
-	packet->set_dst_ip_anno(IPAddress(iph->ip_dst));
-
-	// UDP header
-	click_udp *udpHeader = (click_udp *) (packet->data() + sizeof(click_ip));
-	udpHeader->uh_sport = srcPort;
-	udpHeader->uh_dport = dstPort;
-	udpHeader->uh_ulen = htons(packet->length() - sizeof(click_ip));
-	udpHeader->uh_sum = 0;
-
-
-	RegistrationReply* reply =
-	(RegistrationReply*) (packet->data() + sizeof(click_ip) + sizeof(click_udp));
-	reply->type = 3;
-	reply->code = _checkRequest(request, homeAgent);
-	reply->lifetime = request->lifetime;
-	if (homeAgent && (ntohs(request->lifetime) > registrationLifetime)) reply->lifetime = htons(registrationLifetime);
-	if (!homeAgent && (reply->code == 69)) reply->lifetime = htons(maxLifetimeForeignAgent);
-	reply->homeAddress = IPAddress(request->homeAddress).addr();
-	reply->homeAgent = IPAddress(request->homeAgent).addr();
-	reply->identification = request->identification;
-
-	// Set the UDP header checksum based on the initialized values
-	unsigned csum = click_in_cksum((unsigned char *)udpHeader, sizeof(click_udp) + sizeof(RegistrationReply));
-	udpHeader->uh_sum = click_in_cksum_pseudohdr(csum, iph, sizeof(click_udp) + sizeof(RegistrationReply));
-
-	return packet;
-}
-
-IPAddress RoutingElement::_findCareOfAddress(IPAddress mobileNodeAddress){
-	IPAddress returnValue = IPAddress();
-	for (int i=0; i < _mobilityBindings.size(); i++){
-		MobilityBinding tempBinding = _mobilityBindings.at(i);
-		if (IPAddress(tempBinding.homeAddress) == mobileNodeAddress){
-			returnValue = IPAddress(tempBinding.careOfAddress);
-			break;
-		}
-	}
-	return returnValue;
-}
-
-IPAddress RoutingElement::_updateMobilityBindings(MobilityBinding data, bool valid){
-	LOG("[RoutingElement] Mobility bindings size = %d", _mobilityBindings.size());
-	bool isPresent = false;
-	for (Vector<MobilityBinding>::iterator it=_mobilityBindings.begin(); it != _mobilityBindings.end(); it++){
-		if (data.homeAddress == it->homeAddress){ // MN has an active binding
-			isPresent = true;
-			if (data.lifetime == 0) {
-				// If MN deregisters a specific binding with lifetime 0
-				// MN is back home
-				if (valid)
-					it = _mobilityBindings.erase(it);
-				return IPAddress(data.homeAddress);
-			} else {
-				// MN sends a new valid request for an existing binding
-				// and the according binding is updated
-				if (valid) it->lifetime = data.lifetime;
-				break;
-			}
-		}
-	}
-	// If MN has no active binding, add it to the vector
-	if (!isPresent && valid) _mobilityBindings.push_back(data);
-	return IPAddress(data.careOfAddress);
-}
-
-void RoutingElement::_updateVisitors(RegistrationReply* reply) {
-	// TODO delete the older entries if reply was valid and keep newest(page 53 RFC)
-	for (Vector<VisitorEntry>::iterator it=_visitors.begin(); it != _visitors.end(); it++){
-		// Found corresponding entry
-		// MN source address is the same as the reply homeAddress
-		if (ntohl(reply->homeAddress) == it->sourceIPAddress) {
-			if (ntohs(reply->lifetime) == 0) {
-				it = _visitors.erase(it);
-				continue;
-			}
-			it->remainingLifetime = ntohs(reply->lifetime);
-			if (maxLifetimeForeignAgent < ntohs(reply->lifetime)) it->remainingLifetime = maxLifetimeForeignAgent;
-			it->identification = reply->identification;
-		}
-	}
-}
-
-void RoutingElement::_addPendingVisitor(RegistrationRequest* request, uint32_t dst, uint16_t port){
-	VisitorEntry entry;
-	entry.linkLayerAddress = 0;
-	entry.sourceIPAddress = ntohl(request->homeAddress);
-	entry.destinationIPAddress = dst;
-	entry.udpSourcePort = port;
-	entry.homeAgentAddress = ntohl(request->homeAgent);
-	entry.identification = request->identification;
-	entry.requestLifetime = ntohs(request->lifetime);
-	entry.remainingLifetime = entry.requestLifetime;
-	_visitors.push_back(entry);
-}
-
-void RoutingElement::_deletePendingVisitor(RegistrationReply* reply){
-	for (Vector<VisitorEntry>::iterator it=_visitors.begin(); it != _visitors.end(); it++){
-		// Found corresponding entry
-		// MN source address is the same as the reply homeAddress
-		// and identification field match
-		if (ntohl(reply->homeAddress) == it->sourceIPAddress && reply->identification == it->identification){
-			it = _visitors.erase(it);
-			return;
-		}
-	}
-}
-
-void RoutingElement::_decreaseLifetimeMobilityBindings(){
-	Vector<MobilityBinding> updatedBindings;
-	for (Vector<MobilityBinding>::iterator it=_mobilityBindings.begin(); it != _mobilityBindings.end(); it++){
-		if (it->lifetime == 0xffff) { // If lifetime is infinity dont decrement it
-			updatedBindings.push_back(*it);
-			continue;
-		}
-		it->lifetime--;
-		if (it->lifetime <= 0) {
-			LOG("Registration was not renewed in time, so delete it from the active bindings");
-			continue;
-		}
-		updatedBindings.push_back(*it); // If lifetime is still valid (> 0) keep the binding
-	}
-	// Discard the expired and keep the active bindings
-	_mobilityBindings = updatedBindings;
-}
-
-void RoutingElement::_decreaseLifetimeVisitors(){
-	Vector<VisitorEntry> updatedVisitors;
-	for (Vector<VisitorEntry>::iterator it=_visitors.begin(); it != _visitors.end(); it++){
-		if (it->requestLifetime == 0xffff){// If lifetime is infinity dont decrement it
-			updatedVisitors.push_back(*it);
-			continue;
-		}
-		it->remainingLifetime--;
-		if (it->remainingLifetime <= 0) {
-			LOG("Registration was not renewed in time, so delete it from the visitors list");
-			continue;
-		}
-		updatedVisitors.push_back(*it); // If lifetime is still valid (> 0) keep the binding
-	}
-	// Discard the expired and keep the active visitors
-	_visitors = updatedVisitors;
-}
-
-uint8_t RoutingElement::_checkRequest(RegistrationRequest* request, bool homeAgent){
-	if (homeAgent){
-		// In our annotated version of RFC5944
-		// we only support a couple of things
-		// so reply with code 128 if we don't support the requested functionality
-		if (request->D == 1 || request->B == 1 || request->T == 1 || request->M == 1 || request->G == 1) return 128;
-
-		// If the x and r bit are not 0 ==> poorly formed request
-		if (request->x != 0 || request->r != 0) return 134;
-
-		// If the home agent address 255.255.255.255
-		// return code 136 (Unknown home agent address)
-		if (request->homeAgent == broadCast.addr()) return 136;
-	} else {
-		// If the requested lifetime is too long ==> return code 69
-		if (ntohs(request->lifetime) > maxLifetimeForeignAgent) return 69;
-
-		// If the x and r bit are not 0 ==> poorly formed request
-		if (request->x != 0 || request->r != 0) return 70;
-
-		// GRE encapsulation and minimal encapsulation not supported in this version
-		if (request->M == 1 || request->G == 1) return 72;
-
-		// Support for error code 64
-
-	}
-
-	// Supposed to be 1 but we keep it 0 for this evaluation
-	return 0;
-}
-
-bool RoutingElement::_findVisitorEntry(RegistrationReply* reply, VisitorEntry& foundEntry){
-	for (Vector<VisitorEntry>::iterator it=_visitors.begin(); it != _visitors.end(); it++){
-		// Found corresponding entry
-		// MN source address is the same as the reply homeAddress
-		// and identification field match
-		if (ntohl(reply->homeAddress) == it->sourceIPAddress && reply->identification == it->identification){
-			foundEntry = *it;
-			return true;
-		}
+	// The inner datagram is forwarded, so its TTL is decremented (RFC2003 3.1)
+	if (innerIP->ip_ttl <= 1) {
+		LOGERROR("[RoutingElement] Dropped IP in IP packet for %s, its TTL ran out",
+			 IPAddress(innerIP->ip_dst).unparse().c_str());
+		_counters.add(C_DECAP_DROPPED);
+		p->kill();
+		return;
 	}
-	return false;
+	WritablePacket* q = p->uniqueify();
+	if (!q)
+		return;
+	// Strip the outer header in place and forward to mobile node.
+	// The IP checksum is set on the way to the private network
+	q->pull(outerLength);
+	click_ip* inner = (click_ip*) q->data();
+	inner->ip_ttl--;
+	q->set_ip_header(inner, innerLength);
+	q->set_dst_ip_anno(IPAddress(inner->ip_dst));
+	_counters.add(C_DECAPSULATED);
+	_counters.add(C_DECAP_BYTES, q->length());
+	output(0).push(q);
 }
 
 CLICK_ENDDECLS
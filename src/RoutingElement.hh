@@ -1,45 +1,92 @@
 #ifndef CLICK_ROUTINGELEMENT_HH
 #define CLICK_ROUTINGELEMENT_HH
 #include <click/element.hh>
-#include <click/timer.hh>
+#include <click/task.hh>
+#include <click/notifier.hh>
 
 // Local imports
 #include "Advertiser.hh"
 #include "structs/MobilityBinding.hh"
 #include "structs/ICMPSolicitation.hh"
-#include "structs/RegistrationRequest.hh"
-#include "structs/RegistrationReply.hh"
-#include "structs/VisitorEntry.hh"
+#include "utils/BindingTable.hh"
+#include "utils/VisitorTable.hh"
+#include "utils/PathStats.hh"
+#include "utils/Metrics.hh"
 
 CLICK_DECLS
 /*
  *	Click element that will:
  *	- function like a routing element for the agent
  *	- handle incoming messages like the ICMP solicitations message
- *	- handle the registration request message at the agent side
- *	- generate specific replies depending the current situation
+ *	- hand the registration messages to the Registrar, off the forwarding path
  *	Input 0 ==> directed messages to the agent itself
  * 	Input 1 ==> messages from the CN
+ *		push: every packet is handled on its own
+ *		pull (e.g. behind a Queue): a task drains the input in bursts of BURST packets
  * 	Output 0 ==> packets to private network
  *	Output 1 ==> packets to the public network
  * 	Output 2 ==> packets to the agent itself
+ *	Output 3 ==> registration requests and replies (UDP port 434), connect to a Registrar
+ *	Read handlers:
+ *	- tunnel_hits ==> CN packets tunneled to the care of address of their destination
+ *	- tunnel_misses ==> CN packets without binding for their destination, sent natively
+ *	- tunnel_fallthrough ==> CN packets sent natively because no mobile node is away
+ *	- bindings ==> number of active mobility bindings
+ *	- decap_packets ==> IP in IP packets decapsulated for a visitor
+ *	- decap_dropped ==> IP in IP packets dropped for an unknown visitor or home agent, or
+ *	  because the TTL of the inner datagram ran out
+ *	- decap_malformed ==> IP in IP packets dropped because of a malformed header
+ *	- visitors ==> number of entries in the visitors list
+ *	- visitors_pending ==> visitors still waiting for the reply of their home agent
+ *	- visitors_evicted ==> pending visitors dropped for newer requests of the same MN
+ *	- burst ==> CN packets pulled per task run
+ *	- path_<path>_<stat> ==> TSC cycles spent per packet on a path, including the elements
+ *	  downstream in the same push (only with PATHSTATS, see utils/PathStats.hh)
+ *	  path: cn, solicitation, decap, registration (hand off to the Registrar)
+ *	  cn packets pulled from a Queue are timed per batch (see BURST), every packet counts
+ *	  the average of its batch, so their percentiles and maximum are those of the batches
+ *	  stat: count, avg, p50, p99, p999, max
+ *	Write handlers:
+ *	- burst ==> CN packets pulled per task run, between 1 and 64 (see benchmarks/tunnel_batch.click)
+ *	- reset_paths ==> clear the path histograms
+ *	Metrics (see MetricsExporter): CN packets per result, encapsulated bytes, decapsulated
+ *	packets per result, solicitations, registration messages, local deliveries, bindings, visitors
 */
-class RoutingElement : public Element {
+class RoutingElement : public Element, public MetricsSource {
 	public:
 		RoutingElement();
 		~RoutingElement();
 
 		const char *class_name() const	{ return "RoutingElement"; }
-		const char *port_count() const	{ return "2/3"; }
-		const char *processing() const	{ return PUSH; }
+		const char *port_count() const	{ return "2/4"; }
+		const char *processing() const	{ return "ha/h"; }
 		int configure(Vector<String>&, ErrorHandler*);
 		int initialize(ErrorHandler *);
-		void run_timer(Timer* t);
+		bool run_task(Task*);
 		void push(int, Packet* p);
+		void add_handlers();
+		void* cast(const char*);
+		void writeMetrics(StringAccum&) const;
+
+		// The binding table, shared with the TunnelShard elements of this agent
+		// The Registrar of this agent is its only writer
+		BindingTable* bindingTable() { return &_mobilityBindings; }
+
+		// The visitors list, written by the Registrar of this agent
+		VisitorTable* visitorTable() { return &_visitors; }
 
 	private:
-		// Timer which keeps the mobility bindings up to date
-		Timer _mobilityTimer;
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		// Task which drains input 1 when it is pulled
+		Task _task;
+
+		// Signal of the upstream queue of input 1, the task sleeps while it is empty
+		NotifierSignal _signal;
+
+		// Maximum number of CN packets handled per task run
+		unsigned _burst;
 
 		// Public IPAddress of the agent
 		IPAddress _agentAddressPublic;
@@ -48,62 +95,40 @@ class RoutingElement : public Element {
 		IPAddress _agentAddressPrivate;
 
 		// Keep track of MN which are not home
-		Vector<MobilityBinding> _mobilityBindings;
+		// Indexed by home address so lookups on the forwarding path stay O(1)
+		// The Registrar publishes new versions of the bindings,
+		// the forwarding path (also in TunnelShard elements) reads them without locking
+		BindingTable _mobilityBindings;
+
+		// Reader slot of this element in the binding table
+		int _reader;
 
 		// Keep track of visitors on the current network (FA side)
-		Vector<VisitorEntry> _visitors;
+		VisitorTable _visitors;
+
+		// Per-thread packet and byte counters of the paths (tunneled, decapsulated, ...)
+		MetricCounters _counters;
 
 		// Reference to the advertiser element
 		Advertiser* _advertiser;
 
-		// Respond to an ICMP solicition message
-		void _solicitationResponse(Packet* p);
+#if PATHSTATS
+		// Cycles per packet of the paths through push() and run_task()
+		PathStats _paths;
+#endif
 
-		// Respond to a Mobile IP registration request.
-		void _registrationRequestResponse(Packet* p);
+		// Forward a packet from the CN, binding is 0 if its destination is not away
+		void _forwardCorrespondent(Packet* p, const MobilityBinding* binding);
 
-		// Relay the Mobile IP registration reply to the MN.
-		void _registrationReplyRelay(Packet* p);
+		// Respond to an ICMP solicition message
+		void _solicitationResponse(Packet* p);
 
 		// Encapsulate the incoming IP packet in an outer IP header according RFC2003
-		void _encapIPinIP(Packet* p, IPAddress coa);
-
-		//  Generate a reply based on a specific request
-		Packet* _generateReply(IPAddress, uint16_t, uint16_t, RegistrationRequest*, bool);
-
-		// Find the care of address for the mobile node which is away
-		// This information is stored in the mobilitybindings attribute
-		IPAddress _findCareOfAddress(IPAddress mobileNode);
-
-		// Create, update or delete MobilityBinding for the MN request
-		// Bool indicates if it was a valid request
-		// Return the IPAddress to which the reply must be sent
-		IPAddress _updateMobilityBindings(MobilityBinding, bool);
-
-		// Update the entry in the visitors list based on the incoming reply
-		void _updateVisitors(RegistrationReply*);
-
-		// Add entry to the _visitors list
-		// Based on the request, the destination of the message and the udp source port
-		void _addPendingVisitor(RegistrationRequest*, uint32_t, uint16_t);
-
-		// If registration was denied, delete the pending visitor
-		void _deletePendingVisitor(RegistrationReply*);
-
-		// Decreases all the lifetime fields in the mobility bindings vector
-		void _decreaseLifetimeMobilityBindings();
-
-		// Decreases all the lifetime fields in the visitors vector
-		void _decreaseLifetimeVisitors();
-
-		// Check request and return various codes for the reply
-		// Code 0 indicates that request was valid
-		// For other codes we refer to RFC5944
-		// The boolean parameter indicates if this agent is working like a HA or FA
-		uint8_t _checkRequest(RegistrationRequest*, bool);
+		// The outer header is copied from the template cached in the binding
+		void _encapIPinIP(Packet* p, const MobilityBinding&);
 
-		// Find corresponding entry in visitors list according to incoming reply
-		bool _findVisitorEntry(RegistrationReply*, VisitorEntry& foundEntry);
+		// Validate and strip the outer IP header of a tunneled packet according RFC2003
+		void _decapIPinIP(Packet* p);
 
 };
 
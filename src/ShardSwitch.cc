@@ -0,0 +1,38 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <clicknet/ip.h>
+
+// Local imports
+#include "ShardSwitch.hh"
+
+CLICK_DECLS
+ShardSwitch::ShardSwitch(): _routingElement(0), _bindings(0){}
+
+ShardSwitch::~ ShardSwitch(){}
+
+int ShardSwitch::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"ROUTINGELEMENT", cpkM, (RoutingElement*) cpElement, &_routingElement, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	return 0;
+}
+
+int ShardSwitch::initialize(ErrorHandler *errh) {
+	_bindings = _routingElement->bindingTable();
+	if ((unsigned) noutputs() != _bindings->shards())
+		return errh->error("%d outputs, but the binding table has %u shards", noutputs(), _bindings->shards());
+	return 0;
+}
+
+void ShardSwitch::push(int, Packet* p){
+	const click_ip* iph = (const click_ip*) p->data();
+	output(_bindings->shardOf(IPAddress(iph->ip_dst))).push(p);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(RoutingElement)
+EXPORT_ELEMENT(ShardSwitch)
@@ -0,0 +1,39 @@
+#ifndef CLICK_SHARDSWITCH_HH
+#define CLICK_SHARDSWITCH_HH
+#include <click/element.hh>
+
+// Local imports
+#include "RoutingElement.hh"
+
+CLICK_DECLS
+
+/*
+ *	Click element that splits the CN traffic of a home agent over its TunnelShard elements
+ *	A packet leaves on the output of the binding table shard of its IP destination address,
+ *	so every TunnelShard only reads the buckets of its own shard of the table
+ *	Input 0 ==> messages from the CN
+ *	Output n ==> messages for the mobile nodes in shard n of the binding table
+ *	There must be one output per shard (SHARDS of the RoutingElement)
+*/
+class ShardSwitch : public Element {
+	public:
+		ShardSwitch();
+		~ShardSwitch();
+
+		const char *class_name() const	{ return "ShardSwitch"; }
+		const char *port_count() const	{ return "1/1-"; }
+		const char *processing() const	{ return PUSH; }
+		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
+		void push(int, Packet* p);
+
+	private:
+		// The routing element which owns the bindings
+		RoutingElement* _routingElement;
+
+		// The binding table of the routing element
+		BindingTable* _bindings;
+};
+
+CLICK_ENDDECLS
+#endif
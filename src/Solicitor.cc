@@ -1,6 +1,7 @@
 #include <click/config.h>
 #include <click/confparse.hh>
 #include <click/error.hh>
+#include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include <clicknet/ip.h>
 
@@ -10,10 +11,10 @@
 #include "utils/HelperFunctions.hh"
 
 #define MAX_SOLICITATION_DELAY 1
-#define SOLICITATION_INTERVAL 5
 
 CLICK_DECLS
-Solicitor::Solicitor():_solicitationTimer(this){}
+Solicitor::Solicitor():_solicitationTimer(this), _state(SOLICITOR_BURST), _burst(3), _initialInterval(1000), _maxInterval(60000),
+	_burstLeft(0), _interval(1000), _advertisementHeard(false), _sent(0), _suppressed(0){}
 
 Solicitor::~ Solicitor(){}
 
@@ -21,23 +22,74 @@ int Solicitor::configure(Vector<String> &conf, ErrorHandler *errh) {
 	if (cp_va_kparse(
 		conf, this, errh, \
 		"SRC", cpkM, cpIPAddress, &_srcAddress, \
+		"BURST", cpkN, cpUnsigned, &_burst, \
+		"INTERVAL", cpkN, cpSecondsAsMilli, &_initialInterval, \
+		"MAX_INTERVAL", cpkN, cpSecondsAsMilli, &_maxInterval, \
 		cpEnd) < 0) {
 			return -1;
 	}
+	if (_burst < 1)
+		return errh->error("BURST must be at least 1");
+	if (_initialInterval < 1)
+		return errh->error("INTERVAL must be positive");
+	if (_maxInterval < _initialInterval)
+		return errh->error("MAX_INTERVAL must be at least INTERVAL");
  	// Solicitation timer randomization uses IPAddress as seed
 	srand (_srcAddress.addr());
+	return 0;
+}
+
+int Solicitor::initialize(ErrorHandler *) {
 	_solicitationTimer.initialize(this);
-	// Generate solicitation on start up
+	// Solicit on attach
+	startBurst();
+	return 0;
+}
+
+void Solicitor::startBurst() {
+	LOG("[Solicitor] Starting a burst of %u solicitations", _burst);
+	_state = SOLICITOR_BURST;
+	_burstLeft = _burst;
+	_interval = _initialInterval;
+	_advertisementHeard = false;
 	unsigned int delay = generateRandomNumber(0, MAX_SOLICITATION_DELAY*1000);
 	_solicitationTimer.schedule_after_msec(delay);
-	return 0;
+}
+
+void Solicitor::advertisementReceived(bool solicited) {
+	if (!solicited) {
+		_advertisementHeard = true;
+		_state = SOLICITOR_QUIET;
+	} else if (_state == SOLICITOR_BURST) {
+		_state = SOLICITOR_BACKOFF;
+	}
+}
+
+void Solicitor::_scheduleNext() {
+	unsigned int jitter = _interval / 4;
+	_solicitationTimer.schedule_after_msec(generateRandomNumber(_interval - jitter, _interval + jitter));
 }
 
 void Solicitor::run_timer(Timer* t){
-	if (t == &_solicitationTimer) {
+	if (t != &_solicitationTimer)
+		return;
+	if (_advertisementHeard) {
+		// The agent is heard, no need to look for one
+		_advertisementHeard = false;
+		_suppressed++;
+	} else {
 		generateSolicitation();
-		_solicitationTimer.schedule_after_sec(SOLICITATION_INTERVAL);
+		_lastSent = Timestamp::now_steady();
+		_sent++;
+		if (_state == SOLICITOR_BURST && --_burstLeft > 0) {
+			_scheduleNext();
+			return;
+		}
+		_state = SOLICITOR_BACKOFF;
 	}
+	// Exponential backoff, also while quiet
+	_interval = _interval > _maxInterval / 2 ? _maxInterval : _interval * 2;
+	_scheduleNext();
 }
 
 void Solicitor::generateSolicitation() {
@@ -76,5 +128,67 @@ void Solicitor::generateSolicitation() {
 	output(0).push(packet);
 }
 
+enum { H_STATE, H_INTERVAL, H_SENT, H_SUPPRESSED, H_MAX_INTERVAL, H_SOLICIT };
+
+static const char* const stateNames[] = { "burst", "backoff", "quiet" };
+
+String Solicitor::read_handler(Element* e, void* thunk){
+	Solicitor* solicitor = (Solicitor*) e;
+	switch ((intptr_t) thunk) {
+		case H_STATE:
+			return String(stateNames[solicitor->_state]);
+		case H_INTERVAL:
+			return String(solicitor->_interval);
+		case H_SENT:
+			return String(solicitor->_sent);
+		case H_SUPPRESSED:
+			return String(solicitor->_suppressed);
+		case H_MAX_INTERVAL:
+			return String(solicitor->_maxInterval);
+		default:
+			return String();
+	}
+}
+
+int Solicitor::write_handler(const String& input, Element* e, void* thunk, ErrorHandler* errh){
+	Solicitor* solicitor = (Solicitor*) e;
+	uint32_t value;
+	switch ((intptr_t) thunk) {
+		case H_SOLICIT:
+			solicitor->startBurst();
+			return 0;
+		case H_MAX_INTERVAL:
+			if (!cp_seconds_as_milli(input, &value) || value < solicitor->_initialInterval)
+				return errh->error("max_interval must be at least INTERVAL");
+			solicitor->_maxInterval = value;
+			if (solicitor->_interval > value)
+				solicitor->_interval = value;
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void Solicitor::add_handlers(){
+	add_read_handler("state", read_handler, H_STATE);
+	add_read_handler("interval", read_handler, H_INTERVAL);
+	add_read_handler("sent", read_handler, H_SENT);
+	add_read_handler("suppressed", read_handler, H_SUPPRESSED);
+	add_read_handler("max_interval", read_handler, H_MAX_INTERVAL);
+	add_write_handler("max_interval", write_handler, H_MAX_INTERVAL);
+	add_write_handler("solicit", write_handler, H_SOLICIT, Handler::BUTTON);
+}
+
+void* Solicitor::cast(const char* name){
+	if (strcmp(name, "MetricsSource") == 0)
+		return static_cast<MetricsSource*>(this);
+	return Element::cast(name);
+}
+
+void Solicitor::writeMetrics(StringAccum& sa) const {
+	writeMetric(sa, this, "solicitations_sent_total", _sent);
+	writeMetric(sa, this, "solicitations_suppressed_total", _suppressed);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(Solicitor)
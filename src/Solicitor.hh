@@ -2,12 +2,39 @@
 #define CLICK_SOLICITOR_HH
 #include <click/element.hh>
 #include <click/timer.hh>
+
+// Local imports
+#include "utils/Metrics.hh"
+
 CLICK_DECLS
 
+// States of the solicitor
+enum SolicitorState { SOLICITOR_BURST, SOLICITOR_BACKOFF, SOLICITOR_QUIET };
+
 /*
  * Click element that generates solicitation messages at the mobile node.
+ *	The Monitor drives it:
+ *	- on attach (start up) and when the Monitor suspects a movement (its agent is lost) it
+ *	  sends a burst of BURST solicitations, INTERVAL apart (default 3, 1 second)
+ *	- after the burst the interval doubles after every solicitation, up to MAX_INTERVAL
+ *	  (default 60 seconds), every interval is jittered by -25% to +25%
+ *	- an answer to a solicitation ends the burst, every unsolicited advertisement the Monitor
+ *	  receives makes it quiet: a solicitation that is due while advertisements arrive is
+ *	  suppressed, it is only sent when no advertisement arrived during the last interval
+ *	  (backoff state again)
+ *	- the first solicitation of a burst is delayed by 0 to MAX_SOLICITATION_DELAY (1 second)
+ *	Output 0 ==> the solicitations (IP, broadcast)
+ *	Read handlers:
+ *	- state ==> burst, backoff or quiet
+ *	- interval ==> current interval between solicitations, in milliseconds
+ *	- sent, suppressed ==> solicitations sent, and suppressed because advertisements arrive
+ *	- max_interval ==> MAX_INTERVAL, in milliseconds
+ *	Write handlers:
+ *	- solicit ==> start a burst
+ *	- max_interval ==> change MAX_INTERVAL (seconds, at least INTERVAL)
+ *	Metrics (see MetricsExporter): solicitations sent and suppressed
 */
-class Solicitor : public Element {
+class Solicitor : public Element, public MetricsSource {
 	public:
 		Solicitor();
 		~Solicitor();
@@ -16,14 +43,57 @@ class Solicitor : public Element {
 		const char *port_count() const	{ return "0/1"; }
 		const char *processing() const	{ return PUSH; }
 		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler*);
+		void add_handlers();
+		void* cast(const char*);
+		void writeMetrics(StringAccum&) const;
 
 		void generateSolicitation();
 		void run_timer(Timer* t);
 
+		// Called by the Monitor on attach or when it suspects a movement
+		void startBurst();
+
+		// Called by the Monitor for every valid advertisement, solicited if it answers a
+		// solicitation
+		void advertisementReceived(bool solicited);
+
+		// Current interval between solicitations, in milliseconds
+		unsigned interval() const	{ return _interval; }
+
+		// Time the last solicitation was sent (steady clock), zero if none was sent
+		Timestamp lastSolicitation() const	{ return _lastSent; }
+
 	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		// Schedule the next solicitation after the current interval, jittered
+		void _scheduleNext();
+
 		// The source address
 		IPAddress _srcAddress;
 		Timer _solicitationTimer;
+
+		SolicitorState _state;
+
+		// BURST, INTERVAL and MAX_INTERVAL (in milliseconds)
+		unsigned _burst;
+		unsigned _initialInterval;
+		unsigned _maxInterval;
+
+		// Solicitations left in the current burst
+		unsigned _burstLeft;
+
+		// Current interval between solicitations, in milliseconds
+		unsigned _interval;
+
+		// An advertisement arrived since the last solicitation was due
+		bool _advertisementHeard;
+
+		Timestamp _lastSent;
+		uint64_t _sent;
+		uint64_t _suppressed;
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,88 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+
+// Local imports
+#include "ThroughputSink.hh"
+
+CLICK_DECLS
+ThroughputSink::ThroughputSink(): _count(0), _bytes(0){}
+
+ThroughputSink::~ ThroughputSink(){}
+
+int ThroughputSink::initialize(ErrorHandler*){
+	_start = Timestamp::now();
+	return 0;
+}
+
+void ThroughputSink::push(int, Packet* p){
+	Timestamp now = Timestamp::now();
+	if (!_count)
+		_first = now;
+	_last = now;
+	_count++;
+	_bytes += p->length();
+	if (p->timestamp_anno())
+		_latency.add((now - p->timestamp_anno()).nsecval());
+	p->kill();
+}
+
+enum { H_COUNT, H_BYTES, H_ELAPSED_USEC, H_FIRST_USEC, H_MPPS, H_GBPS, H_RESET, H_LATENCY };
+
+String ThroughputSink::read_handler(Element* e, void* thunk){
+	ThroughputSink* sink = (ThroughputSink*) e;
+	double elapsed = (sink->_last - sink->_first).doubleval();
+	switch ((intptr_t) thunk) {
+		case H_COUNT:
+			return String(sink->_count);
+		case H_BYTES:
+			return String(sink->_bytes);
+		case H_ELAPSED_USEC:
+			return String((sink->_last - sink->_first).usecval());
+		case H_FIRST_USEC:
+			if (!sink->_count)
+				return String(0);
+			return String((sink->_first - sink->_start).usecval());
+		case H_MPPS:
+			if (elapsed <= 0)
+				return String(0);
+			return String(sink->_count / elapsed / 1e6);
+		case H_GBPS:
+			if (elapsed <= 0)
+				return String(0);
+			return String(sink->_bytes * 8 / elapsed / 1e9);
+		default:
+			return String(sink->_latency.stat((intptr_t) thunk - H_LATENCY));
+	}
+}
+
+int ThroughputSink::write_handler(const String&, Element* e, void* thunk, ErrorHandler*){
+	ThroughputSink* sink = (ThroughputSink*) e;
+	switch ((intptr_t) thunk) {
+		case H_RESET:
+			sink->_count = 0;
+			sink->_bytes = 0;
+			sink->_first = sink->_last = Timestamp();
+			sink->_start = Timestamp::now();
+			sink->_latency.clear();
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void ThroughputSink::add_handlers(){
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("bytes", read_handler, H_BYTES);
+	add_read_handler("elapsed_usec", read_handler, H_ELAPSED_USEC);
+	add_read_handler("first_usec", read_handler, H_FIRST_USEC);
+	add_read_handler("mpps", read_handler, H_MPPS);
+	add_read_handler("gbps", read_handler, H_GBPS);
+	for (int stat = 0; stat < HISTOGRAM_STATS; stat++)
+		add_read_handler(String("latency_") + LatencyHistogram::statName(stat), read_handler, H_LATENCY + stat);
+	add_write_handler("reset", write_handler, H_RESET, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(ThroughputSink)
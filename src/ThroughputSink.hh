@@ -0,0 +1,55 @@
+#ifndef CLICK_THROUGHPUTSINK_HH
+#define CLICK_THROUGHPUTSINK_HH
+#include <click/element.hh>
+
+// Local imports
+#include "utils/LatencyHistogram.hh"
+
+CLICK_DECLS
+
+/*
+ *	Click element that discards packets and measures their throughput and latency
+ *	It is the end of the tunnel benchmarks (see benchmarks/tunnel_stress.click)
+ *	- the throughput is measured between the first and the last packet since the last reset
+ *	- bytes are the lengths of the packets as they arrive (e.g. Ethernet frames without FCS)
+ *	- the latency of a packet is the time since its timestamp annotation (see
+ *	  CorrespondentSource), packets without annotation are not in the latency histogram
+ *	Input 0 ==> packets to discard
+ *	Read handlers:
+ *	- count, bytes ==> packets and bytes received
+ *	- elapsed_usec ==> time between the first and the last packet, in microseconds
+ *	- first_usec ==> time from the initialization of the sink or the last reset to the first
+ *	  packet, in microseconds (see benchmarks/store_restart.click)
+ *	- mpps, gbps ==> millions of packets and gigabits per second
+ *	- latency_<stat> ==> time since the timestamp annotation, in nanoseconds
+ *	  stat: count, avg, p50, p99, p999, max
+ *	Write handlers:
+ *	- reset ==> reset the counts and the latency histogram
+*/
+class ThroughputSink : public Element {
+	public:
+		ThroughputSink();
+		~ThroughputSink();
+
+		const char *class_name() const	{ return "ThroughputSink"; }
+		const char *port_count() const	{ return PORTS_1_0; }
+		const char *processing() const	{ return PUSH; }
+		int initialize(ErrorHandler*);
+		void push(int, Packet* p);
+		void add_handlers();
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		uint64_t _count;
+		uint64_t _bytes;
+		Timestamp _start;
+		Timestamp _first;
+		Timestamp _last;
+
+		LatencyHistogram _latency;
+};
+
+CLICK_ENDDECLS
+#endif
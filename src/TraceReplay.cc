@@ -0,0 +1,210 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+
+// Local imports
+#include "TraceReplay.hh"
+#include <click/standard/scheduleinfo.hh>
+
+#define REPLAY_BURST 32
+
+CLICK_DECLS
+TraceReplay::TraceReplay(): _task(this), _timer(&_task), _loaded(false), _loops(1), _timing(false), _stop(false), _active(true), _burst(REPLAY_BURST), _loopCall(0), _loop(0), _next(0), _boundary(false), _count(0){}
+
+TraceReplay::~ TraceReplay(){
+	delete _loopCall;
+}
+
+int TraceReplay::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"LOOPS", cpkN, cpUnsigned, &_loops, \
+		"TIMING", cpkN, cpBool, &_timing, \
+		"STOP", cpkN, cpBool, &_stop, \
+		"ACTIVE", cpkN, cpBool, &_active, \
+		"BURST", cpkN, cpUnsigned, &_burst, \
+		"LOOP_CALL", cpkN, cpHandlerCallPtrWrite, &_loopCall, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_burst < 1)
+		return errh->error("BURST must be at least 1");
+	return 0;
+}
+
+int TraceReplay::initialize(ErrorHandler *errh) {
+	ScheduleInfo::initialize_task(this, &_task, errh);
+	_signal = Notifier::upstream_empty_signal(this, 0, &_task);
+	for (int port = 1; port < ninputs(); port++)
+		_signal += Notifier::upstream_empty_signal(this, port, &_task);
+	_inputs.resize(ninputs());
+	_timer.initialize(this);
+	if (_loopCall && _loopCall->initialize_write(this, errh) < 0)
+		return -1;
+	return 0;
+}
+
+void TraceReplay::cleanup(CleanupStage){
+	for (int port = 0; port < _inputs.size(); port++)
+		for (int i = 0; i < _inputs[port].size(); i++)
+			_inputs[port][i]->kill();
+	_inputs.clear();
+	for (int i = 0; i < _trace.size(); i++)
+		_trace[i]->kill();
+	_trace.clear();
+}
+
+bool TraceReplay::_load(){
+	for (int port = 0; port < ninputs(); port++)
+		while (Packet* p = input(port).pull())
+			_inputs[port].push_back(p);
+	if (_signal)
+		return false;
+	_merge();
+	// One millisecond between the end of a loop and the start of the next
+	if (_trace.size())
+		_duration = _offsets.back() + Timestamp::make_msec(1);
+	return true;
+}
+
+void TraceReplay::_merge(){
+	// The trace starts with the earliest packet of all inputs
+	Timestamp first;
+	for (int port = 0; port < _inputs.size(); port++)
+		if (_inputs[port].size() && (!first || _inputs[port][0]->timestamp_anno() < first))
+			first = _inputs[port][0]->timestamp_anno();
+	// Captures are not always in time order, offsets never go back within an input
+	Vector<int> next(_inputs.size(), 0);
+	Vector<Timestamp> last(_inputs.size(), Timestamp());
+	while (true) {
+		int port = -1;
+		Timestamp offset;
+		for (int i = 0; i < _inputs.size(); i++) {
+			if (next[i] == _inputs[i].size())
+				continue;
+			Timestamp candidate = _inputs[i][next[i]]->timestamp_anno() - first;
+			if (candidate < last[i])
+				candidate = last[i];
+			// Ties go to the lowest input
+			if (port < 0 || candidate < offset) {
+				port = i;
+				offset = candidate;
+			}
+		}
+		if (port < 0)
+			break;
+		_trace.push_back(_inputs[port][next[port]++]);
+		_ports.push_back(port);
+		_offsets.push_back(offset);
+		last[port] = offset;
+	}
+	_inputs.clear();
+}
+
+bool TraceReplay::run_task(Task*){
+	if (!_loaded) {
+		_loaded = _load();
+		if (!_loaded) {
+			_task.fast_reschedule();
+			return false;
+		}
+	}
+	if (!_active)
+		return false;
+	if (!_count)
+		_start = Timestamp::now_steady();
+	if (_boundary) {
+		_boundary = false;
+		_loopCall->call_write(ErrorHandler::default_handler());
+	}
+	if (_loop >= _loops || _trace.empty()) {
+		if (_stop)
+			router()->please_stop_driver();
+		_stop = false;
+		return false;
+	}
+
+	unsigned count = 0;
+	while (count < _burst && _loop < _loops) {
+		Timestamp now = Timestamp::now_steady();
+		if (_timing) {
+			Timestamp due = _start + _duration * (int) _loop + _offsets[_next];
+			if (now < due) {
+				_timer.schedule_at_steady(due);
+				return count > 0;
+			}
+		}
+		Packet* p = _trace[_next];
+		// The default headroom of a device leaves room for a tunnel header
+		WritablePacket* copy = Packet::make(Packet::default_headroom, p->data(), p->length(), 0);
+		if (copy) {
+			copy->set_timestamp_anno(Timestamp::now());
+			_count++;
+			_last = now;
+			output(_ports[_next]).push(copy);
+		}
+		count++;
+		if (++_next == _trace.size()) {
+			_next = 0;
+			_loop++;
+			// The rest of the router runs before LOOP_CALL
+			if (_loopCall && _loop < _loops) {
+				_boundary = true;
+				break;
+			}
+		}
+	}
+	_task.fast_reschedule();
+	return count > 0;
+}
+
+enum { H_COUNT, H_LOOPS, H_ELAPSED, H_RATE, H_ACTIVE };
+
+String TraceReplay::read_handler(Element* e, void* thunk){
+	TraceReplay* replay = (TraceReplay*) e;
+	uint64_t elapsed = replay->_count ? (replay->_last - replay->_start).usecval() : 0;
+	switch ((intptr_t) thunk) {
+		case H_COUNT:
+			return String(replay->_count);
+		case H_LOOPS:
+			return String(replay->_loop);
+		case H_ELAPSED:
+			return String(elapsed);
+		case H_RATE:
+			if (elapsed == 0)
+				return String(0);
+			return String(replay->_count * 1000000 / elapsed);
+		case H_ACTIVE:
+			return String(replay->_active);
+		default:
+			return String();
+	}
+}
+
+int TraceReplay::write_handler(const String& input, Element* e, void* thunk, ErrorHandler* errh){
+	TraceReplay* replay = (TraceReplay*) e;
+	switch ((intptr_t) thunk) {
+		case H_ACTIVE:
+			if (!cp_bool(input, &replay->_active))
+				return errh->error("active must be a boolean");
+			if (replay->_active)
+				replay->_task.reschedule();
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void TraceReplay::add_handlers(){
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("loops", read_handler, H_LOOPS);
+	add_read_handler("elapsed_usec", read_handler, H_ELAPSED);
+	add_read_handler("rate", read_handler, H_RATE);
+	add_read_handler("active", read_handler, H_ACTIVE);
+	add_write_handler("active", write_handler, H_ACTIVE);
+	add_task_handlers(&_task);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(TraceReplay)
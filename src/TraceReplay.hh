@@ -0,0 +1,101 @@
+#ifndef CLICK_TRACEREPLAY_HH
+#define CLICK_TRACEREPLAY_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/task.hh>
+#include <click/notifier.hh>
+#include <click/handlercall.hh>
+
+CLICK_DECLS
+
+/*
+ *	Click element that loads packet traces (e.g. from FromDump) and replays them LOOPS times
+ *	It is used by the benchmarks to amplify the captures in resources/pcap-files
+ *	- the whole traces are pulled from the inputs before the replay starts
+ *	- the traces are replayed as one, in the order of their timestamps, every packet on the
+ *	  output of its input. Captures of several links with one clock keep their causal order
+ *	- every replayed packet is a fresh copy, like a packet received from a device
+ *	- TIMING false replays as fast as possible, TIMING true keeps the gaps of the trace
+ *	- STOP true asks the driver to stop when the last loop is done (see DriverManager)
+ *	- ACTIVE false holds the replay until the active handler is set, e.g. by a Script that
+ *	  prepares the router first
+ *	- BURST packets are replayed per task run (default REPLAY_BURST), 1 lets the tasks of
+ *	  the router handle every packet before the next one
+ *	- LOOP_CALL is a write handler called between two loops, e.g. to reset the router state,
+ *	  on a task run of its own so the packets of the previous loop are handled first
+ *	Input n (pull) ==> a trace
+ *	Output n ==> the replayed packets of trace n
+ *	Read handlers:
+ *	- count ==> packets replayed
+ *	- loops ==> loops completed
+ *	- elapsed_usec ==> time between the first and the last replayed packet, in microseconds
+ *	- rate ==> packets replayed per second
+ *	- active ==> true if the replay runs
+ *	Write handlers:
+ *	- active ==> start (true) or pause (false) the replay
+*/
+class TraceReplay : public Element {
+	public:
+		TraceReplay();
+		~TraceReplay();
+
+		const char *class_name() const	{ return "TraceReplay"; }
+		const char *port_count() const	{ return "1-/="; }
+		const char *processing() const	{ return PULL_TO_PUSH; }
+		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
+		void cleanup(CleanupStage);
+		bool run_task(Task*);
+		void add_handlers();
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		Task _task;
+
+		// Wakes the task up when the next packet is due (TIMING)
+		Timer _timer;
+
+		// Signal of the upstream traces, it goes down at the end of the last trace
+		NotifierSignal _signal;
+
+		// The traces while they are loaded, one per input
+		Vector<Vector<Packet*> > _inputs;
+
+		// The merged trace, the port of every packet and its offset from the start of the trace
+		Vector<Packet*> _trace;
+		Vector<int> _ports;
+		Vector<Timestamp> _offsets;
+
+		// Duration of one loop of the trace
+		Timestamp _duration;
+
+		bool _loaded;
+		unsigned _loops;
+		bool _timing;
+		bool _stop;
+		bool _active;
+		unsigned _burst;
+		HandlerCall* _loopCall;
+
+		// Position of the replay
+		unsigned _loop;
+		int _next;
+
+		// A loop is done and LOOP_CALL is due before the next one
+		bool _boundary;
+
+		uint64_t _count;
+		Timestamp _start;
+		Timestamp _last;
+
+		// Pull the traces from the inputs, true once they are complete
+		bool _load();
+
+		// Merge the loaded traces by timestamp into _trace
+		void _merge();
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,130 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <click/master.hh>
+#include <clicknet/ip.h>
+
+// Local imports
+#include "TunnelShard.hh"
+#include "utils/HelperFunctions.hh"
+
+#define MAX_BURST 64
+
+CLICK_DECLS
+TunnelShard::TunnelShard(): _task(this), _burst(32), _thread(-1), _tunnelHits(0), _tunnelMisses(0), _tunnelFallthrough(0), _encapBytes(0){}
+
+TunnelShard::~ TunnelShard(){}
+
+int TunnelShard::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"ROUTINGELEMENT", cpkM, (RoutingElement*) cpElement, &_routingElement, \
+		"BURST", cpkN, cpUnsigned, &_burst, \
+		"THREAD", cpkN, cpInteger, &_thread, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_burst < 1 || _burst > MAX_BURST)
+		return errh->error("BURST must be between 1 and %d", MAX_BURST);
+	return 0;
+}
+
+int TunnelShard::initialize(ErrorHandler *errh) {
+	_bindings = _routingElement->bindingTable();
+	_reader = _bindings->addReader();
+	if (_reader < 0)
+		return errh->error("too many readers of the binding table");
+	ScheduleInfo::initialize_task(this, &_task, errh);
+	if (_thread >= 0)
+		_task.move_thread(_thread % master()->nthreads());
+	_signal = Notifier::upstream_empty_signal(this, 0, &_task);
+	return 0;
+}
+
+bool TunnelShard::run_task(Task*){
+	Packet* batch[MAX_BURST];
+	const MobilityBinding* bindings[MAX_BURST];
+	unsigned count = 0;
+	while (count < _burst) {
+		Packet* p = input(0).pull();
+		if (!p)
+			break;
+		batch[count++] = p;
+	}
+
+	// Look up the bindings of the whole batch first and prefetch the tunnel headers
+	_bindings->readBegin(_reader);
+	bool bindingsEmpty = _bindings->empty();
+	for (unsigned i = 0; i < count; i++) {
+		bindings[i] = 0;
+		if (!bindingsEmpty) {
+			const click_ip* iph = (const click_ip*) batch[i]->data();
+			bindings[i] = _bindings->lookup(IPAddress(iph->ip_dst));
+			if (bindings[i])
+				__builtin_prefetch(&bindings[i]->tunnelHeader);
+		}
+	}
+
+	// Encapsulate and forward the batch
+	for (unsigned i = 0; i < count; i++) {
+		if (bindingsEmpty) {
+			_tunnelFallthrough++;
+			output(0).push(batch[i]);
+		} else if (!bindings[i]) {
+			_tunnelMisses++;
+			output(0).push(batch[i]);
+		} else {
+			_tunnelHits++;
+			if (WritablePacket* p = encapIPinIP(batch[i], *bindings[i])) {
+				_encapBytes += p->length();
+				output(1).push(p);
+			}
+		}
+	}
+	_bindings->readEnd(_reader);
+
+	if (count == _burst || _signal)
+		_task.fast_reschedule();
+	return count > 0;
+}
+
+enum { H_TUNNEL_HITS, H_TUNNEL_MISSES, H_TUNNEL_FALLTHROUGH };
+
+String TunnelShard::read_handler(Element* e, void* thunk){
+	TunnelShard* shard = (TunnelShard*) e;
+	switch ((intptr_t) thunk) {
+		case H_TUNNEL_HITS:
+			return String(shard->_tunnelHits);
+		case H_TUNNEL_MISSES:
+			return String(shard->_tunnelMisses);
+		case H_TUNNEL_FALLTHROUGH:
+			return String(shard->_tunnelFallthrough);
+		default:
+			return String();
+	}
+}
+
+void* TunnelShard::cast(const char* name){
+	if (strcmp(name, "MetricsSource") == 0)
+		return static_cast<MetricsSource*>(this);
+	return Element::cast(name);
+}
+
+void TunnelShard::writeMetrics(StringAccum& sa) const {
+	writeMetric(sa, this, "cn_packets_total", _tunnelHits, "result=\"tunneled\"");
+	writeMetric(sa, this, "cn_packets_total", _tunnelMisses, "result=\"miss\"");
+	writeMetric(sa, this, "cn_packets_total", _tunnelFallthrough, "result=\"fallthrough\"");
+	writeMetric(sa, this, "encapsulated_bytes_total", _encapBytes);
+}
+
+void TunnelShard::add_handlers(){
+	add_read_handler("tunnel_hits", read_handler, H_TUNNEL_HITS);
+	add_read_handler("tunnel_misses", read_handler, H_TUNNEL_MISSES);
+	add_read_handler("tunnel_fallthrough", read_handler, H_TUNNEL_FALLTHROUGH);
+	add_task_handlers(&_task);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(RoutingElement)
+EXPORT_ELEMENT(TunnelShard)
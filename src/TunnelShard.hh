@@ -0,0 +1,78 @@
+#ifndef CLICK_TUNNELSHARD_HH
+#define CLICK_TUNNELSHARD_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/notifier.hh>
+
+// Local imports
+#include "RoutingElement.hh"
+#include "utils/Metrics.hh"
+
+CLICK_DECLS
+
+/*
+ *	Click element that forwards the CN traffic of one shard of a home agent
+ *	It reads the bindings of the RoutingElement without locking, so several
+ *	shards can run on their own thread (see StaticThreadSched and ShardSwitch)
+ *	- with THREAD n, the task runs on thread n modulo the threads of the router
+ *	  (click -j), so one configuration spreads its shards over any number of threads
+ *	Input 0 (pull) ==> messages from the CN, drained in bursts of BURST packets
+ *	Output 0 ==> packets to the private network (destination is at home)
+ *	Output 1 ==> packets tunneled to the public network
+ *	Read handlers:
+ *	- tunnel_hits, tunnel_misses, tunnel_fallthrough ==> same as RoutingElement
+ *	Metrics (see MetricsExporter): CN packets per result, encapsulated bytes
+ *	The counters have a single writer, the thread of the shard
+*/
+class TunnelShard : public Element, public MetricsSource {
+	public:
+		TunnelShard();
+		~TunnelShard();
+
+		const char *class_name() const	{ return "TunnelShard"; }
+		const char *port_count() const	{ return "1/2"; }
+		const char *processing() const	{ return PULL_TO_PUSH; }
+		int configure(Vector<String>&, ErrorHandler*);
+		int initialize(ErrorHandler *);
+		bool run_task(Task*);
+		void add_handlers();
+		void* cast(const char*);
+		void writeMetrics(StringAccum&) const;
+
+	private:
+		static String read_handler(Element*, void*);
+
+		// Task which drains the input
+		Task _task;
+
+		// Signal of the upstream queue, the task sleeps while it is empty
+		NotifierSignal _signal;
+
+		// Maximum number of packets handled per task run
+		unsigned _burst;
+
+		// Preferred home thread of the task, -1 for the default
+		int _thread;
+
+		// The routing element which owns the bindings
+		RoutingElement* _routingElement;
+
+		// The binding table and the reader slot of this shard in it
+		BindingTable* _bindings;
+		int _reader;
+
+		// Packets tunneled to a care of address
+		uint64_t _tunnelHits;
+
+		// Packets without binding for their destination, sent natively
+		uint64_t _tunnelMisses;
+
+		// Packets sent natively because no mobile node is away
+		uint64_t _tunnelFallthrough;
+
+		// Bytes of the tunneled packets, outer header included
+		uint64_t _encapBytes;
+};
+
+CLICK_ENDDECLS
+#endif
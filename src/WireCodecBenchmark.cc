@@ -0,0 +1,280 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/timestamp.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+
+// Local imports
+#include "WireCodecBenchmark.hh"
+#include "structs/RegistrationRequest.hh"
+#include "structs/RegistrationReply.hh"
+#include "structs/ICMPAdvertisement.hh"
+#include "structs/MobilityAgentAdvertisementExtension.hh"
+#include "structs/WireViews.hh"
+
+// Packets in the buffer of the benchmark, and the room for every packet
+#define CODEC_PACKETS 64
+#define CODEC_STRIDE 64
+
+CLICK_DECLS
+WireCodecBenchmark::WireCodecBenchmark(): _iterations(10000000), _identical(false), _sink(0){
+	memset(_results, 0, sizeof(_results));
+}
+
+WireCodecBenchmark::~ WireCodecBenchmark(){}
+
+int WireCodecBenchmark::configure(Vector<String> &conf, ErrorHandler *errh) {
+	if (cp_va_kparse(
+		conf, this, errh,
+		"ITERATIONS", cpkN, cpUnsigned, &_iterations, \
+		cpEnd) < 0) {
+			return -1;
+	}
+	if (_iterations < CODEC_PACKETS)
+		return errh->error("ITERATIONS must be at least %d", CODEC_PACKETS);
+	return 0;
+}
+
+template <int MESSAGE, int WAY>
+unsigned WireCodecBenchmark::_build(unsigned char* buffer, uint32_t i){
+	// Only the message, the IP and UDP headers are the same for both ways
+	unsigned char* payload = buffer + sizeof(click_ip) + sizeof(click_udp);
+	unsigned length = CODEC_STRIDE - sizeof(click_ip) - sizeof(click_udp);
+	switch (MESSAGE * WAYS + WAY) {
+		case MESSAGE_REQUEST * WAYS + WAY_RAW: {
+			RegistrationRequest* request = (RegistrationRequest*) payload;
+			request->type = 1;
+			request->S = 0;
+			request->B = 0;
+			request->D = 1;
+			request->M = 0;
+			request->G = 0;
+			request->r = 0;
+			request->T = 0;
+			request->x = 0;
+			request->lifetime = htons(i);
+			request->homeAddress = htonl(0xC0A80000 + i);
+			request->homeAgent = htonl(0xC0A800FE);
+			request->careOfAddress = htonl(0x0A000000 + i);
+			request->identification = i;
+			return sizeof(click_ip) + sizeof(click_udp) + sizeof(RegistrationRequest);
+		}
+		case MESSAGE_REQUEST * WAYS + WAY_VIEW: {
+			RegistrationRequestView request(payload, length);
+			request.setType(1);
+			request.setFlags(RegistrationRequestView::FLAG_D);
+			request.setLifetime(i);
+			request.setHomeAddress(IPAddress(htonl(0xC0A80000 + i)));
+			request.setHomeAgent(IPAddress(htonl(0xC0A800FE)));
+			request.setCareOfAddress(IPAddress(htonl(0x0A000000 + i)));
+			request.setIdentification(i);
+			return sizeof(click_ip) + sizeof(click_udp) + RegistrationRequestView::SIZE;
+		}
+		case MESSAGE_REPLY * WAYS + WAY_RAW: {
+			RegistrationReply* reply = (RegistrationReply*) payload;
+			reply->type = 3;
+			reply->code = i & 1;
+			reply->lifetime = htons(i);
+			reply->homeAddress = htonl(0xC0A80000 + i);
+			reply->homeAgent = htonl(0xC0A800FE);
+			reply->identification = i;
+			return sizeof(click_ip) + sizeof(click_udp) + sizeof(RegistrationReply);
+		}
+		case MESSAGE_REPLY * WAYS + WAY_VIEW: {
+			RegistrationReplyView reply(payload, length);
+			reply.setType(3);
+			reply.setCode(i & 1);
+			reply.setLifetime(i);
+			reply.setHomeAddress(IPAddress(htonl(0xC0A80000 + i)));
+			reply.setHomeAgent(IPAddress(htonl(0xC0A800FE)));
+			reply.setIdentification(i);
+			return sizeof(click_ip) + sizeof(click_udp) + RegistrationReplyView::SIZE;
+		}
+		case MESSAGE_ADVERTISEMENT * WAYS + WAY_RAW: {
+			// The advertisement follows the IP header only, the UDP header room stays zero
+			ICMPAdvertisement* advertisement = (ICMPAdvertisement*) (buffer + sizeof(click_ip));
+			advertisement->type = 9;
+			advertisement->code = 0;
+			advertisement->checksum = 0;
+			advertisement->numAddrs = 1;
+			advertisement->addrEntrySize = 2;
+			advertisement->lifetime = htons(1800);
+			advertisement->routerAddress = htonl(0xC0A80000 + i);
+			advertisement->preferenceLevel = htonl(1);
+			MobilityAgentAdvertisementExtension* extension = (MobilityAgentAdvertisementExtension*) (buffer + sizeof(click_ip) + sizeof(ICMPAdvertisement));
+			extension->type = 16;
+			extension->length = 6 + 4;
+			extension->sequenceNumber = htons(i);
+			extension->registrationLifetime = htons(60);
+			extension->R = 1;
+			extension->B = 0;
+			extension->H = 1;
+			extension->F = 1;
+			extension->M = 0;
+			extension->G = 0;
+			extension->r = 0;
+			extension->T = 0;
+			extension->U = 0;
+			extension->X = 0;
+			extension->I = 0;
+			extension->reserved = 0;
+			extension->careOfAddress = htonl(0xC0A80000 + i);
+			return sizeof(click_ip) + sizeof(ICMPAdvertisement) + sizeof(MobilityAgentAdvertisementExtension);
+		}
+		case MESSAGE_ADVERTISEMENT * WAYS + WAY_VIEW: {
+			AdvertisementView advertisement = AdvertisementView::make(buffer + sizeof(click_ip), CODEC_STRIDE - sizeof(click_ip));
+			advertisement.setCode(0);
+			advertisement.setChecksum(0);
+			advertisement.setLifetime(1800);
+			advertisement.setRouterAddress(IPAddress(htonl(0xC0A80000 + i)));
+			advertisement.setPreferenceLevel(1);
+			MobilityExtensionView extension = MobilityExtensionView::make(buffer + sizeof(click_ip) + AdvertisementView::SIZE, CODEC_STRIDE - sizeof(click_ip) - AdvertisementView::SIZE);
+			extension.setSequenceNumber(i);
+			extension.setRegistrationLifetime(60);
+			extension.setFlags(MobilityExtensionView::FLAG_R | MobilityExtensionView::FLAG_H | MobilityExtensionView::FLAG_F);
+			extension.setCareOfAddress(IPAddress(htonl(0xC0A80000 + i)));
+			return sizeof(click_ip) + AdvertisementView::SIZE + MobilityExtensionView::SIZE;
+		}
+		default:
+			return 0;
+	}
+}
+
+template <int MESSAGE, int WAY>
+uint64_t WireCodecBenchmark::_parse(unsigned char* buffer, unsigned length){
+	switch (MESSAGE * WAYS + WAY) {
+		case MESSAGE_REQUEST * WAYS + WAY_RAW: {
+			// Like the elements: no checks, the offsets assume an IP header without options
+			const RegistrationRequest* request = (const RegistrationRequest*) (buffer + sizeof(click_ip) + sizeof(click_udp));
+			return request->type + request->D + ntohs(request->lifetime) + request->homeAddress
+				+ request->homeAgent + request->careOfAddress + request->identification;
+		}
+		case MESSAGE_REQUEST * WAYS + WAY_VIEW: {
+			// Like fromPacket(): the IP header length is known from the annotations
+			RegistrationRequestView request(buffer + sizeof(click_ip) + sizeof(click_udp), length - sizeof(click_ip) - sizeof(click_udp));
+			if (!request.valid())
+				return 0;
+			return request.type() + ((request.flags() & RegistrationRequestView::FLAG_D) != 0) + request.lifetime()
+				+ request.homeAddress().addr() + request.homeAgent().addr() + request.careOfAddress().addr() + request.identification();
+		}
+		case MESSAGE_REPLY * WAYS + WAY_RAW: {
+			const RegistrationReply* reply = (const RegistrationReply*) (buffer + sizeof(click_ip) + sizeof(click_udp));
+			return reply->type + reply->code + ntohs(reply->lifetime) + reply->homeAddress + reply->homeAgent + reply->identification;
+		}
+		case MESSAGE_REPLY * WAYS + WAY_VIEW: {
+			RegistrationReplyView reply(buffer + sizeof(click_ip) + sizeof(click_udp), length - sizeof(click_ip) - sizeof(click_udp));
+			if (!reply.valid())
+				return 0;
+			return reply.type() + reply.code() + reply.lifetime() + reply.homeAddress().addr() + reply.homeAgent().addr() + reply.identification();
+		}
+		case MESSAGE_ADVERTISEMENT * WAYS + WAY_RAW: {
+			// With the checks of Monitor, the extension is assumed after one router address
+			const ICMPAdvertisement* advertisement = (const ICMPAdvertisement*) (buffer + sizeof(click_ip));
+			if (advertisement->numAddrs < 1 || advertisement->addrEntrySize < 2
+			    || length - sizeof(click_ip) < 8u + advertisement->numAddrs * advertisement->addrEntrySize * 4)
+				return 0;
+			const MobilityAgentAdvertisementExtension* extension = (const MobilityAgentAdvertisementExtension*) (buffer + sizeof(click_ip) + sizeof(ICMPAdvertisement));
+			return advertisement->type + advertisement->numAddrs + ntohs(advertisement->lifetime) + advertisement->routerAddress
+				+ ntohs(extension->sequenceNumber) + ntohs(extension->registrationLifetime) + extension->R + extension->careOfAddress;
+		}
+		case MESSAGE_ADVERTISEMENT * WAYS + WAY_VIEW: {
+			AdvertisementView advertisement(buffer + sizeof(click_ip), length - sizeof(click_ip));
+			if (!advertisement.valid())
+				return 0;
+			MobilityExtensionView extension = advertisement.extension();
+			if (!extension.valid())
+				return 0;
+			return advertisement.type() + advertisement.numAddrs() + advertisement.lifetime() + advertisement.routerAddress().addr()
+				+ extension.sequenceNumber() + extension.registrationLifetime() + ((extension.flags() & MobilityExtensionView::FLAG_R) != 0)
+				+ extension.careOfAddress().addr();
+		}
+		default:
+			return 0;
+	}
+}
+
+template <int MESSAGE, int WAY>
+void WireCodecBenchmark::_measure(){
+	unsigned char buffer[CODEC_PACKETS][CODEC_STRIDE];
+	memset(buffer, 0, sizeof(buffer));
+	unsigned length = 0;
+	Timestamp start = Timestamp::now_steady();
+	for (uint32_t i = 0; i < _iterations; i++)
+		length = _build<MESSAGE, WAY>(buffer[i % CODEC_PACKETS], i);
+	_results[MESSAGE][WAY][OPERATION_BUILD] = (double) (Timestamp::now_steady() - start).nsecval() / _iterations;
+
+	// The views read the header length from the IP header
+	for (int i = 0; i < CODEC_PACKETS; i++)
+		buffer[i][0] = 0x45;
+	uint64_t sum = 0;
+	start = Timestamp::now_steady();
+	for (uint32_t i = 0; i < _iterations; i++)
+		sum += _parse<MESSAGE, WAY>(buffer[i % CODEC_PACKETS], length);
+	_results[MESSAGE][WAY][OPERATION_PARSE] = (double) (Timestamp::now_steady() - start).nsecval() / _iterations;
+	_sink += sum;
+}
+
+template <int MESSAGE>
+bool WireCodecBenchmark::_compare(){
+	unsigned char raw[CODEC_STRIDE];
+	unsigned char view[CODEC_STRIDE];
+	memset(raw, 0, sizeof(raw));
+	memset(view, 0, sizeof(view));
+	unsigned rawLength = _build<MESSAGE, WAY_RAW>(raw, 0x1234);
+	unsigned viewLength = _build<MESSAGE, WAY_VIEW>(view, 0x1234);
+	raw[0] = view[0] = 0x45;
+	return rawLength == viewLength && memcmp(raw, view, sizeof(raw)) == 0
+		&& _parse<MESSAGE, WAY_RAW>(raw, rawLength) == _parse<MESSAGE, WAY_VIEW>(raw, rawLength);
+}
+
+void WireCodecBenchmark::_run(){
+	_measure<MESSAGE_REQUEST, WAY_RAW>();
+	_measure<MESSAGE_REQUEST, WAY_VIEW>();
+	_measure<MESSAGE_REPLY, WAY_RAW>();
+	_measure<MESSAGE_REPLY, WAY_VIEW>();
+	_measure<MESSAGE_ADVERTISEMENT, WAY_RAW>();
+	_measure<MESSAGE_ADVERTISEMENT, WAY_VIEW>();
+	_identical = _compare<MESSAGE_REQUEST>() && _compare<MESSAGE_REPLY>() && _compare<MESSAGE_ADVERTISEMENT>();
+}
+
+enum { H_IDENTICAL, H_RUN, H_RESULTS };
+static const char* const messageNames[] = { "request", "reply", "advertisement" };
+static const char* const wayNames[] = { "raw", "view" };
+static const char* const operationNames[] = { "parse", "build" };
+
+String WireCodecBenchmark::read_handler(Element* e, void* thunk){
+	WireCodecBenchmark* benchmark = (WireCodecBenchmark*) e;
+	intptr_t which = (intptr_t) thunk;
+	if (which == H_IDENTICAL)
+		return String(benchmark->_identical);
+	which -= H_RESULTS;
+	int operation = which % OPERATIONS;
+	int way = which / OPERATIONS % WAYS;
+	int message = which / OPERATIONS / WAYS;
+	return String(benchmark->_results[message][way][operation]);
+}
+
+int WireCodecBenchmark::write_handler(const String&, Element* e, void* thunk, ErrorHandler*){
+	WireCodecBenchmark* benchmark = (WireCodecBenchmark*) e;
+	switch ((intptr_t) thunk) {
+		case H_RUN:
+			benchmark->_run();
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+void WireCodecBenchmark::add_handlers(){
+	for (int message = 0; message < MESSAGES; message++)
+		for (int way = 0; way < WAYS; way++)
+			for (int operation = 0; operation < OPERATIONS; operation++)
+				add_read_handler(String(messageNames[message]) + "_" + wayNames[way] + "_" + operationNames[operation], read_handler,
+						 H_RESULTS + (message * WAYS + way) * OPERATIONS + operation);
+	add_read_handler("identical", read_handler, H_IDENTICAL);
+	add_write_handler("run", write_handler, H_RUN, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(WireCodecBenchmark)
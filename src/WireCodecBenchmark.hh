@@ -0,0 +1,68 @@
+#ifndef CLICK_WIRECODECBENCHMARK_HH
+#define CLICK_WIRECODECBENCHMARK_HH
+#include <click/element.hh>
+
+CLICK_DECLS
+
+/*
+ *	Click element that measures the cost of parsing and building the Mobile IP messages
+ *	with the raw struct casts of structs/ and with the views of structs/WireViews.hh
+ *	- the run handler parses and builds ITERATIONS messages of every type both ways
+ *	- messages are spread over a buffer of 64 packets, so the loops do not fold
+ *	- it also checks that both ways build the same bytes and parse the same values
+ *	No ports, use it from a Script (see benchmarks/wire_codec.click)
+ *	Read handlers (nanoseconds per message, after run):
+ *	- <message>_<way>_<operation>
+ *	  message: request, reply, advertisement
+ *	  way: raw, view
+ *	  operation: parse, build
+ *	- identical ==> true if the views build the same bytes as the raw casts
+ *	Write handlers:
+ *	- run ==> run the benchmark
+*/
+class WireCodecBenchmark : public Element {
+	public:
+		WireCodecBenchmark();
+		~WireCodecBenchmark();
+
+		const char *class_name() const	{ return "WireCodecBenchmark"; }
+		const char *port_count() const	{ return PORTS_0_0; }
+		int configure(Vector<String>&, ErrorHandler*);
+		void add_handlers();
+
+		enum { MESSAGE_REQUEST, MESSAGE_REPLY, MESSAGE_ADVERTISEMENT, MESSAGES };
+		enum { WAY_RAW, WAY_VIEW, WAYS };
+		enum { OPERATION_PARSE, OPERATION_BUILD, OPERATIONS };
+
+	private:
+		static String read_handler(Element*, void*);
+		static int write_handler(const String&, Element*, void*, ErrorHandler*);
+
+		unsigned _iterations;
+
+		// Nanoseconds per message of every message, way and operation
+		double _results[MESSAGES][WAYS][OPERATIONS];
+		bool _identical;
+
+		// Sums of the parsed fields, keeps the compiler from dropping the parse loops
+		uint64_t _sink;
+
+		// Build (raw or view) message i of a type in buffer, return its length
+		// Message and way are template arguments and both are inlined, so a loop measures
+		// only the code of one message and way
+		template <int MESSAGE, int WAY> static inline __attribute__((always_inline)) unsigned _build(unsigned char* buffer, uint32_t i);
+
+		// Parse (raw or view) the message of a type in buffer, return the sum of its fields
+		template <int MESSAGE, int WAY> static inline __attribute__((always_inline)) uint64_t _parse(unsigned char* buffer, unsigned length);
+
+		// Time ITERATIONS builds and parses of one message type and way
+		template <int MESSAGE, int WAY> void _measure();
+
+		// True if both ways build the same bytes and parse the same fields
+		template <int MESSAGE> bool _compare();
+
+		void _run();
+};
+
+CLICK_ENDDECLS
+#endif
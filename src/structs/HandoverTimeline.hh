@@ -0,0 +1,20 @@
+// This file contains the struct that keeps the timeline of a handover at the mobile node
+// All times are steady timestamps, unset (zero) until the event happened
+#pragma once
+#include <click/timestamp.hh>
+
+struct HandoverTimeline{
+  // Agent the mobile node moved to, source of its advertisements
+  uint32_t agent;
+  // Identification of the accepted registration with that agent
+  uint64_t identification;
+  // Last data packet received before the first advertisement of the agent
+  Timestamp lastData;
+  // First advertisement of the agent
+  Timestamp advertisement;
+  // Registration request and its accepted reply
+  Timestamp request;
+  Timestamp reply;
+  // First data packet received after the reply
+  Timestamp firstData;
+};
@@ -1,7 +1,33 @@
-#include <click/timer.hh>
+// This file contains an entry of the agent cache of the mobile node (see utils/AgentCache.hh)
+#pragma once
+#include <click/timestamp.hh>
+#include <stdint.h>
+
+// Care of addresses kept per agent, an advertisement may list more
+#define MAX_CARE_OF_ADDRESSES 16
 
 // An entry in the list of available routers for a host.
+// The router address is the source of the advertisements, addresses in network byte order
 struct ICMPRouterEntry {
 	uint32_t routerAddress;
-	uint32_t preferenceLevel;
+	// Preference of the router (RFC 1256), higher is better, host byte order
+	int32_t preferenceLevel;
+
+	// Mobility agent advertisement extension of the last advertisement
+	uint16_t sequenceNumber;
+	uint16_t registrationLifetime;
+	bool registrationRequired;
+	uint8_t careOfAddressCount;
+	uint32_t careOfAddresses[MAX_CARE_OF_ADDRESSES];
+	// Share of the mobile nodes of every care of address (care of address weights extension)
+	uint8_t careOfAddressWeights[MAX_CARE_OF_ADDRESSES];
+
+	// Ethernet source of the last advertisement
+	uint8_t etherAddress[6];
+
+	// Steady clock time at which the advertisement lifetime runs out
+	Timestamp expires;
+
+	// Steady clock time of the last advertisement
+	Timestamp heard;
 };
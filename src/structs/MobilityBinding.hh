@@ -1,9 +1,19 @@
 // This file contains the struct for the Mobility binding of a Mobile node
 // This information is kept at the home agent
+#pragma once
+#include <click/timestamp.hh>
+#include <clicknet/ip.h>
 
 struct MobilityBinding {
     uint32_t homeAddress;
     uint32_t careOfAddress;
     uint16_t lifetime;
     double replyIdentification;
+    // Steady clock time at which the binding expires (unused for infinite lifetime)
+    Timestamp expires;
+    // Prebuilt outer IP header of the tunnel towards the care of address
+    // ip_tos, ip_len and ip_sum are filled in per packet
+    click_ip tunnelHeader;
+    // One's complement sum of the constant fields of tunnelHeader
+    uint32_t tunnelHeaderSum;
 };
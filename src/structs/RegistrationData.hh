@@ -1,4 +1,6 @@
 // This file contains the struct that is used to keep track of the data from the pending registration
+#pragma once
+#include <click/timestamp.hh>
 
 struct RegistrationData{
   uint32_t linkLayerAddress;
@@ -7,4 +9,6 @@ struct RegistrationData{
   double identification;
   uint16_t originalLifetime;
   uint16_t remainingLifetime;
+  // Time the request was sent (steady clock)
+  Timestamp sent;
 };
@@ -0,0 +1,63 @@
+// This file contains the binary record of the event trace (see utils/EventTrace.hh)
+// and the layout of a trace dump. It has no Click dependencies, tools/trace_decode.cc
+// reads dumps with it.
+#pragma once
+#include <stdint.h>
+
+// Mobility state transitions that are traced
+enum TraceEventType {
+	TRACE_ADVERTISEMENT,		// address: agent, peer: care of address, value: sequence number
+	TRACE_REGISTRATION_SENT,	// address: home address, peer: agent, value: lifetime
+	TRACE_REGISTRATION_ACCEPTED,	// address: home address, peer: agent (MN) or care of address (HA), value: code
+	TRACE_REGISTRATION_DENIED,	// address: home address, peer: agent (MN) or care of address (HA), value: code
+	TRACE_BINDING_CREATED,		// address: home address, peer: care of address, value: lifetime
+	TRACE_BINDING_RENEWED,		// address: home address, peer: care of address, value: lifetime
+	TRACE_BINDING_DELETED,		// address: home address, peer: care of address
+	TRACE_BINDING_EXPIRED,		// address: home address, peer: care of address
+	TRACE_VISITOR_ADDED,		// address: home address, peer: home agent, value: lifetime
+	TRACE_VISITOR_ACCEPTED,		// address: home address, peer: home agent, value: lifetime
+	TRACE_VISITOR_REMOVED,		// address: home address, peer: home agent
+	TRACE_VISITOR_EXPIRED,		// address: home address
+	TRACE_HANDOVER,			// address: new agent, peer: previous agent
+	TRACE_AGENT_LOST,		// address: agent, value: missed advertisements (0: lifetime expired)
+	TRACE_EVENT_TYPES
+};
+
+static const char* const traceEventNames[] = {
+	"advertisement", "registration_sent", "registration_accepted", "registration_denied",
+	"binding_created", "binding_renewed", "binding_deleted", "binding_expired",
+	"visitor_added", "visitor_accepted", "visitor_removed", "visitor_expired",
+	"handover", "agent_lost"
+};
+
+inline const char* traceEventName(unsigned type) {
+	return type < TRACE_EVENT_TYPES ? traceEventNames[type] : "unknown";
+}
+
+// One event, 32 bytes, addresses in network byte order
+struct TraceRecord {
+	// Steady clock, in nanoseconds
+	uint64_t time;
+	uint64_t identification;
+	uint32_t address;
+	uint32_t peer;
+	uint16_t type;
+	uint16_t value;
+	// Thread that recorded the event and index of the element in the router
+	uint16_t thread;
+	uint16_t element;
+};
+
+// A dump is a TraceDumpHeader, namesLength bytes of element names ("<index> <name>\n"
+// per element), then per ring its head (uint64_t, events ever recorded in the ring) and
+// its ringSize records. Record i of a ring is in slot i % ringSize.
+#define TRACE_DUMP_MAGIC "MIPTRACE"
+#define TRACE_DUMP_VERSION 1
+
+struct TraceDumpHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t rings;
+	uint32_t ringSize;
+	uint32_t namesLength;
+};
@@ -1,7 +1,14 @@
+#pragma once
 /*
 * The FA MUST maintain a visitor list entry containing the following
 * information obtained from the mobile node’s Registration Request
 */
+#include <click/timestamp.hh>
+#include <click/hashcode.hh>
+
+// A request is pending until the reply of the home agent accepts it
+enum VisitorState { VISITOR_PENDING, VISITOR_ACCEPTED };
+
 struct VisitorEntry{
 	uint32_t linkLayerAddress;
 	uint32_t sourceIPAddress;
@@ -10,5 +17,27 @@ struct VisitorEntry{
 	uint32_t homeAgentAddress;
 	uint64_t identification;
 	uint16_t requestLifetime;
-	uint16_t remainingLifetime;
+	// Steady clock time at which the remaining lifetime runs out
+	// While pending, the time at which the request is given up
+	Timestamp expires;
+	VisitorState state;
+};
+
+// Identifies a visitor entry: the MN home address and the registration identification
+struct VisitorKey{
+	uint32_t homeAddress;
+	uint64_t identification;
+
+	VisitorKey() : homeAddress(0), identification(0) {}
+	VisitorKey(uint32_t address, uint64_t id) : homeAddress(address), identification(id) {}
+
+	bool operator==(const VisitorKey& other) const {
+		return homeAddress == other.homeAddress && identification == other.identification;
+	}
+
+	// Mix the fields, a plain XOR collides when the identification counts along with the address
+	hashcode_t hashcode() const {
+		uint64_t h = (((uint64_t) homeAddress << 32) ^ identification) * 0x9E3779B97F4A7C15ULL;
+		return (hashcode_t) (h >> 32);
+	}
 };
@@ -0,0 +1,319 @@
+// This file contains typed views on the wire format of the Mobile IP messages
+// The structs next to this file overlay packet bytes with bitfields, whose layout depends on
+// the compiler and the byte order of the host. A view knows the offset of every field
+// instead: it checks the length once when it is made, then every accessor is a plain
+// load or store at a constant offset, converted from or to network byte order.
+// - numbers (lifetime, sequence number, ...) are returned in host byte order
+// - addresses are IPAddress, which keeps network byte order like the rest of the code
+// - the identification is an opaque 64 bit value, it is only echoed by the agents
+// Setters write into the packet, the caller makes sure it is writable (like the raw casts).
+#pragma once
+#include <click/glue.hh>
+#include <click/ipaddress.hh>
+#include <click/packet.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include <string.h>
+
+class WireView {
+	public:
+		// The message does not fit in the given bytes, no accessor may be used
+		bool valid() const { return _data != 0; }
+
+		const unsigned char* data() const { return _data; }
+
+	protected:
+		WireView(): _data(0), _length(0) {}
+		WireView(unsigned char* data, unsigned length, unsigned minimum): _data(length >= minimum ? data : 0), _length(length) {}
+
+		unsigned char* _data;
+		unsigned _length;
+
+		uint8_t _load8(unsigned offset) const { return _data[offset]; }
+		uint16_t _load16(unsigned offset) const { uint16_t v; memcpy(&v, _data + offset, 2); return ntohs(v); }
+		uint32_t _load32(unsigned offset) const { uint32_t v; memcpy(&v, _data + offset, 4); return ntohl(v); }
+		IPAddress _loadAddress(unsigned offset) const { uint32_t v; memcpy(&v, _data + offset, 4); return IPAddress(v); }
+		uint64_t _load64Raw(unsigned offset) const { uint64_t v; memcpy(&v, _data + offset, 8); return v; }
+
+		void _store8(unsigned offset, uint8_t v) { _data[offset] = v; }
+		void _store16(unsigned offset, uint16_t v) { v = htons(v); memcpy(_data + offset, &v, 2); }
+		void _store32(unsigned offset, uint32_t v) { v = htonl(v); memcpy(_data + offset, &v, 4); }
+		void _storeAddress(unsigned offset, IPAddress a) { uint32_t v = a.addr(); memcpy(_data + offset, &v, 4); }
+		void _store64Raw(unsigned offset, uint64_t v) { memcpy(_data + offset, &v, 8); }
+
+		// Offset of the UDP payload of an IP packet, 0 if the headers do not fit
+		static unsigned _udpPayload(const unsigned char* data, unsigned length) {
+			if (length < sizeof(click_ip))
+				return 0;
+			unsigned offset = (data[0] & 0x0F) * 4 + sizeof(click_udp);
+			return offset < sizeof(click_ip) + sizeof(click_udp) || offset > length ? 0 : offset;
+		}
+
+		// Start of the UDP payload of an IP packet, from its transport header annotation when
+		// it is set (CheckIPHeader, MarkIPHeader), 0 if the headers do not fit
+		static unsigned char* _udpPayload(const Packet* p, unsigned& length) {
+			unsigned char* data = const_cast<unsigned char*>(p->data());
+			unsigned offset = p->has_transport_header() ? p->transport_header_offset() + sizeof(click_udp) : _udpPayload(data, p->length());
+			if (offset == 0 || offset > p->length())
+				return 0;
+			length = p->length() - offset;
+			return data + offset;
+		}
+};
+
+// Registration request (RFC 5944 section 3.3), UDP payload to port 434
+class RegistrationRequestView : public WireView {
+	public:
+		static constexpr unsigned TYPE = 0;
+		static constexpr unsigned FLAGS = 1;
+		static constexpr unsigned LIFETIME = 2;
+		static constexpr unsigned HOME_ADDRESS = 4;
+		static constexpr unsigned HOME_AGENT = 8;
+		static constexpr unsigned CARE_OF_ADDRESS = 12;
+		static constexpr unsigned IDENTIFICATION = 16;
+		static constexpr unsigned SIZE = 24;
+
+		enum { FLAG_S = 0x80, FLAG_B = 0x40, FLAG_D = 0x20, FLAG_M = 0x10, FLAG_G = 0x08, FLAG_r = 0x04, FLAG_T = 0x02, FLAG_x = 0x01 };
+
+		RegistrationRequestView() {}
+		RegistrationRequestView(unsigned char* data, unsigned length): WireView(data, length, SIZE) {}
+
+		// The request in the UDP payload of the IP packet at data
+		static RegistrationRequestView fromIP(unsigned char* data, unsigned length) {
+			unsigned offset = _udpPayload(data, length);
+			return offset ? RegistrationRequestView(data + offset, length - offset) : RegistrationRequestView();
+		}
+
+		// The request in the UDP payload of an IP packet
+		static RegistrationRequestView fromPacket(const Packet* p) {
+			unsigned length;
+			unsigned char* payload = _udpPayload(p, length);
+			return payload ? RegistrationRequestView(payload, length) : RegistrationRequestView();
+		}
+
+		uint8_t type() const { return _load8(TYPE); }
+		uint8_t flags() const { return _load8(FLAGS); }
+		uint16_t lifetime() const { return _load16(LIFETIME); }
+		IPAddress homeAddress() const { return _loadAddress(HOME_ADDRESS); }
+		IPAddress homeAgent() const { return _loadAddress(HOME_AGENT); }
+		IPAddress careOfAddress() const { return _loadAddress(CARE_OF_ADDRESS); }
+		uint64_t identification() const { return _load64Raw(IDENTIFICATION); }
+
+		void setType(uint8_t v) { _store8(TYPE, v); }
+		void setFlags(uint8_t v) { _store8(FLAGS, v); }
+		void setLifetime(uint16_t v) { _store16(LIFETIME, v); }
+		void setHomeAddress(IPAddress v) { _storeAddress(HOME_ADDRESS, v); }
+		void setHomeAgent(IPAddress v) { _storeAddress(HOME_AGENT, v); }
+		void setCareOfAddress(IPAddress v) { _storeAddress(CARE_OF_ADDRESS, v); }
+		void setIdentification(uint64_t v) { _store64Raw(IDENTIFICATION, v); }
+};
+
+// Registration reply (RFC 5944 section 3.4), UDP payload from port 434
+class RegistrationReplyView : public WireView {
+	public:
+		static constexpr unsigned TYPE = 0;
+		static constexpr unsigned CODE = 1;
+		static constexpr unsigned LIFETIME = 2;
+		static constexpr unsigned HOME_ADDRESS = 4;
+		static constexpr unsigned HOME_AGENT = 8;
+		static constexpr unsigned IDENTIFICATION = 12;
+		static constexpr unsigned SIZE = 20;
+
+		RegistrationReplyView() {}
+		RegistrationReplyView(unsigned char* data, unsigned length): WireView(data, length, SIZE) {}
+
+		// The reply in the UDP payload of the IP packet at data
+		static RegistrationReplyView fromIP(unsigned char* data, unsigned length) {
+			unsigned offset = _udpPayload(data, length);
+			return offset ? RegistrationReplyView(data + offset, length - offset) : RegistrationReplyView();
+		}
+
+		// The reply in the UDP payload of an IP packet
+		static RegistrationReplyView fromPacket(const Packet* p) {
+			unsigned length;
+			unsigned char* payload = _udpPayload(p, length);
+			return payload ? RegistrationReplyView(payload, length) : RegistrationReplyView();
+		}
+
+		uint8_t type() const { return _load8(TYPE); }
+		uint8_t code() const { return _load8(CODE); }
+		uint16_t lifetime() const { return _load16(LIFETIME); }
+		IPAddress homeAddress() const { return _loadAddress(HOME_ADDRESS); }
+		IPAddress homeAgent() const { return _loadAddress(HOME_AGENT); }
+		uint64_t identification() const { return _load64Raw(IDENTIFICATION); }
+
+		void setType(uint8_t v) { _store8(TYPE, v); }
+		void setCode(uint8_t v) { _store8(CODE, v); }
+		void setLifetime(uint16_t v) { _store16(LIFETIME, v); }
+		void setHomeAddress(IPAddress v) { _storeAddress(HOME_ADDRESS, v); }
+		void setHomeAgent(IPAddress v) { _storeAddress(HOME_AGENT, v); }
+		void setIdentification(uint64_t v) { _store64Raw(IDENTIFICATION, v); }
+};
+
+// Mobility agent advertisement extension (RFC 5944 section 2.1.1)
+// It follows the router addresses of an ICMP router advertisement
+class MobilityExtensionView : public WireView {
+	public:
+		static constexpr unsigned TYPE = 0;
+		static constexpr unsigned LENGTH = 1;
+		static constexpr unsigned SEQUENCE_NUMBER = 2;
+		static constexpr unsigned REGISTRATION_LIFETIME = 4;
+		static constexpr unsigned FLAGS = 6;
+		static constexpr unsigned CARE_OF_ADDRESSES = 8;
+		// Size with one care of address
+		static constexpr unsigned SIZE = 12;
+
+		enum { FLAG_R = 0x8000, FLAG_B = 0x4000, FLAG_H = 0x2000, FLAG_F = 0x1000, FLAG_M = 0x0800, FLAG_G = 0x0400,
+		       FLAG_r = 0x0200, FLAG_T = 0x0100, FLAG_U = 0x0080, FLAG_X = 0x0040, FLAG_I = 0x0020 };
+
+		MobilityExtensionView() {}
+		MobilityExtensionView(unsigned char* data, unsigned length): WireView(data, length, SIZE) {
+			// The length field counts the bytes after itself, they must all be there
+			if (_data && (unsigned) _data[LENGTH] + 2 > length)
+				_data = 0;
+		}
+
+		// Start a new extension with the given number of care of addresses in data
+		static MobilityExtensionView make(unsigned char* data, unsigned length, int careOfAddresses = 1) {
+			if (length < CARE_OF_ADDRESSES + 4 * careOfAddresses)
+				return MobilityExtensionView();
+			data[TYPE] = 16;
+			data[LENGTH] = CARE_OF_ADDRESSES - 2 + 4 * careOfAddresses;
+			return MobilityExtensionView(data, length);
+		}
+
+		uint8_t type() const { return _load8(TYPE); }
+		uint8_t length() const { return _load8(LENGTH); }
+		uint16_t sequenceNumber() const { return _load16(SEQUENCE_NUMBER); }
+		uint16_t registrationLifetime() const { return _load16(REGISTRATION_LIFETIME); }
+		uint16_t flags() const { return _load16(FLAGS); }
+		int careOfAddresses() const { return length() < CARE_OF_ADDRESSES - 2 ? 0 : (length() - (CARE_OF_ADDRESSES - 2)) / 4; }
+		IPAddress careOfAddress(int i = 0) const { return _loadAddress(CARE_OF_ADDRESSES + 4 * i); }
+
+		void setType(uint8_t v) { _store8(TYPE, v); }
+		void setLength(uint8_t v) { _store8(LENGTH, v); }
+		void setSequenceNumber(uint16_t v) { _store16(SEQUENCE_NUMBER, v); }
+		void setRegistrationLifetime(uint16_t v) { _store16(REGISTRATION_LIFETIME, v); }
+		void setFlags(uint16_t v) { _store16(FLAGS, v); }
+		void setCareOfAddress(IPAddress v, int i = 0) { _storeAddress(CARE_OF_ADDRESSES + 4 * i, v); }
+};
+
+// Care of address weights extension, a local extension after the mobility agent advertisement
+// extension. Its type is in the range of the skippable extensions (RFC 5944 section 2.1), so
+// mobile nodes that do not know it ignore it. It holds one weight byte per care of address, in
+// the order of the mobility agent advertisement extension.
+class CareOfWeightsView : public WireView {
+	public:
+		static constexpr unsigned TYPE = 0;
+		static constexpr unsigned LENGTH = 1;
+		static constexpr unsigned WEIGHTS = 2;
+		// Size with one weight
+		static constexpr unsigned SIZE = 3;
+		static constexpr uint8_t EXTENSION_TYPE = 200;
+
+		CareOfWeightsView() {}
+		CareOfWeightsView(unsigned char* data, unsigned length): WireView(data, length, SIZE) {
+			if (_data && (_data[TYPE] != EXTENSION_TYPE || (unsigned) _data[LENGTH] + 2 > length))
+				_data = 0;
+		}
+
+		// Start a new extension with the given number of weights in data
+		static CareOfWeightsView make(unsigned char* data, unsigned length, int weights) {
+			if (length < WEIGHTS + weights)
+				return CareOfWeightsView();
+			data[TYPE] = EXTENSION_TYPE;
+			data[LENGTH] = weights;
+			return CareOfWeightsView(data, length);
+		}
+
+		uint8_t length() const { return _load8(LENGTH); }
+		int weights() const { return length(); }
+		uint8_t weight(int i) const { return _load8(WEIGHTS + i); }
+
+		void setWeight(uint8_t v, int i) { _store8(WEIGHTS + i, v); }
+};
+
+// ICMP router advertisement (RFC 1256), the ICMP message after the IP header
+class AdvertisementView : public WireView {
+	public:
+		static constexpr unsigned TYPE = 0;
+		static constexpr unsigned CODE = 1;
+		static constexpr unsigned CHECKSUM = 2;
+		static constexpr unsigned NUM_ADDRS = 4;
+		static constexpr unsigned ADDR_ENTRY_SIZE = 5;
+		static constexpr unsigned LIFETIME = 6;
+		static constexpr unsigned ROUTER_ADDRESSES = 8;
+		// Size with one router address
+		static constexpr unsigned SIZE = 16;
+
+		AdvertisementView(): _extension(0) {}
+		AdvertisementView(unsigned char* data, unsigned length): WireView(data, length, SIZE), _extension(0) {
+			// Every router address entry must be there
+			if (_data) {
+				// One address of two words is the common case, a constant offset lets the
+				// loads of the extension start before the entry fields are known
+				if (__builtin_expect(numAddrs() == 1 && addrEntrySize() == 2, 1))
+					_extension = SIZE;
+				else
+					_extension = ROUTER_ADDRESSES + numAddrs() * addrEntrySize() * 4;
+				if (numAddrs() < 1 || addrEntrySize() < 2 || _extension > length)
+					_data = 0;
+			}
+		}
+
+		// Start a new advertisement with the given router address entries in data
+		static AdvertisementView make(unsigned char* data, unsigned length, uint8_t numAddrs = 1, uint8_t addrEntrySize = 2) {
+			if (length < ROUTER_ADDRESSES + numAddrs * addrEntrySize * 4u)
+				return AdvertisementView();
+			data[TYPE] = 9;
+			data[NUM_ADDRS] = numAddrs;
+			data[ADDR_ENTRY_SIZE] = addrEntrySize;
+			return AdvertisementView(data, length);
+		}
+
+		uint8_t type() const { return _load8(TYPE); }
+		uint8_t code() const { return _load8(CODE); }
+		uint16_t checksum() const { return _load16(CHECKSUM); }
+		uint8_t numAddrs() const { return _load8(NUM_ADDRS); }
+		uint8_t addrEntrySize() const { return _load8(ADDR_ENTRY_SIZE); }
+		uint16_t lifetime() const { return _load16(LIFETIME); }
+		IPAddress routerAddress(int i = 0) const { return _loadAddress(ROUTER_ADDRESSES + i * addrEntrySize() * 4); }
+		uint32_t preferenceLevel(int i = 0) const { return _load32(ROUTER_ADDRESSES + i * addrEntrySize() * 4 + 4); }
+
+		// The mobility agent advertisement extension after the router addresses, invalid if absent
+		MobilityExtensionView extension() const {
+			return MobilityExtensionView(_data + _extension, _length - _extension);
+		}
+
+		// The care of address weights extension among the extensions after the mobility agent
+		// advertisement extension, invalid if absent
+		CareOfWeightsView careOfWeights() const {
+			MobilityExtensionView mobility = extension();
+			if (!mobility.valid())
+				return CareOfWeightsView();
+			unsigned offset = _extension + 2 + mobility.length();
+			while (offset + 2 <= _length) {
+				// Pad extensions are a single byte (RFC 5944 section 2.1.3)
+				if (_data[offset] == 0)
+					offset++;
+				else if (_data[offset] == CareOfWeightsView::EXTENSION_TYPE)
+					return CareOfWeightsView(_data + offset, _length - offset);
+				else
+					offset += 2 + _data[offset + 1];
+			}
+			return CareOfWeightsView();
+		}
+
+		void setType(uint8_t v) { _store8(TYPE, v); }
+		void setCode(uint8_t v) { _store8(CODE, v); }
+		void setChecksum(uint16_t v) { _store16(CHECKSUM, v); }
+		void setNumAddrs(uint8_t v) { _store8(NUM_ADDRS, v); }
+		void setAddrEntrySize(uint8_t v) { _store8(ADDR_ENTRY_SIZE, v); }
+		void setLifetime(uint16_t v) { _store16(LIFETIME, v); }
+		void setRouterAddress(IPAddress v, int i = 0) { _storeAddress(ROUTER_ADDRESSES + i * addrEntrySize() * 4, v); }
+		void setPreferenceLevel(uint32_t v, int i = 0) { _store32(ROUTER_ADDRESSES + i * addrEntrySize() * 4 + 4, v); }
+
+	private:
+		// Offset of the extension, after the router address entries
+		unsigned _extension;
+};
@@ -0,0 +1,105 @@
+// Decodes a dump of the event trace, written by the dump handler of an EventTracer or by
+// its crash handler (see structs/TraceRecord.hh), into the lines of its events handler:
+//   <time> <thread> <element> <event> <address> <peer> <identification> <value>
+// The events of all threads are merged, oldest first. Events are filtered by name with
+// the optional arguments.
+//
+// It does not need Click, build it with: g++ -O2 -o trace_decode trace_decode.cc
+// Usage: trace_decode <dump> [event...]
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../structs/TraceRecord.hh"
+
+static bool recordLess(const TraceRecord& a, const TraceRecord& b){
+	return a.time < b.time;
+}
+
+static std::string address(uint32_t address){
+	char text[INET_ADDRSTRLEN];
+	struct in_addr in;
+	in.s_addr = address;
+	return inet_ntop(AF_INET, &in, text, sizeof(text)) ? text : "?";
+}
+
+int main(int argc, char** argv){
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <dump> [event...]\n", argv[0]);
+		return 2;
+	}
+	FILE* file = fopen(argv[1], "rb");
+	if (!file) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	TraceDumpHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic)) != 0) {
+		fprintf(stderr, "%s: not an event trace dump\n", argv[1]);
+		return 1;
+	}
+	if (header.version != TRACE_DUMP_VERSION) {
+		fprintf(stderr, "%s: dump version %u, expected %u\n", argv[1], header.version, TRACE_DUMP_VERSION);
+		return 1;
+	}
+
+	// Element names, "<index> <name>\n" per element
+	std::string names(header.namesLength, '\0');
+	if (header.namesLength && fread(&names[0], header.namesLength, 1, file) != 1) {
+		fprintf(stderr, "%s: truncated element names\n", argv[1]);
+		return 1;
+	}
+	std::map<unsigned, std::string> elements;
+	for (size_t start = 0; start < names.size(); ) {
+		size_t end = names.find('\n', start);
+		if (end == std::string::npos)
+			end = names.size();
+		size_t space = names.find(' ', start);
+		if (space < end)
+			elements[strtoul(names.c_str() + start, 0, 10)] = names.substr(space + 1, end - space - 1);
+		start = end + 1;
+	}
+
+	// The records of a ring that were written, oldest first: the last ringSize of head
+	std::vector<TraceRecord> records;
+	std::vector<TraceRecord> ring(header.ringSize);
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < header.rings; i++) {
+		uint64_t head;
+		if (fread(&head, sizeof(head), 1, file) != 1 || (header.ringSize && fread(&ring[0], sizeof(TraceRecord), header.ringSize, file) != header.ringSize)) {
+			fprintf(stderr, "%s: truncated ring %u\n", argv[1], i);
+			return 1;
+		}
+		total += head;
+		uint64_t first = head > header.ringSize ? head - header.ringSize : 0;
+		for (uint64_t j = first; j < head; j++)
+			records.push_back(ring[j % header.ringSize]);
+	}
+	fclose(file);
+	std::stable_sort(records.begin(), records.end(), recordLess);
+
+	for (size_t i = 0; i < records.size(); i++) {
+		const TraceRecord& r = records[i];
+		const char* event = traceEventName(r.type);
+		if (argc > 2) {
+			bool selected = false;
+			for (int j = 2; j < argc && !selected; j++)
+				selected = strcmp(argv[j], event) == 0;
+			if (!selected)
+				continue;
+		}
+		std::map<unsigned, std::string>::const_iterator element = elements.find(r.element);
+		std::string elementName = element != elements.end() ? element->second : std::to_string(r.element);
+		printf("%llu.%09llu %u %s %s %s %s %llu %u\n",
+			(unsigned long long) (r.time / 1000000000), (unsigned long long) (r.time % 1000000000),
+			r.thread, elementName.c_str(), event, address(r.address).c_str(), address(r.peer).c_str(),
+			(unsigned long long) r.identification, r.value);
+	}
+	fprintf(stderr, "%zu events, %llu recorded\n", records.size(), (unsigned long long) total);
+	return 0;
+}
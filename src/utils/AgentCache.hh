@@ -0,0 +1,71 @@
+// This file contains the agent cache of the mobile node: the agents it recently heard of
+// It holds at most capacity entries, ordered from the best to the worst agent (highest
+// preference first, the most recently heard first among equals), so the best agent is the
+// first entry that is not expired. An agent is dropped when its advertisement lifetime runs
+// out, when the mobile node loses it or when it denies a registration. A full cache drops
+// its worst entry for an agent that is at least as good.
+#pragma once
+#include <click/vector.hh>
+#include "../structs/ICMPRouterEntry.hh"
+
+class AgentCache {
+	public:
+		AgentCache() : _capacity(8) {}
+
+		void setCapacity(int capacity) { _capacity = capacity; }
+		int size() const { return _agents.size(); }
+		const ICMPRouterEntry& operator[](int i) const { return _agents[i]; }
+
+		// Add or refresh the entry of an agent after one of its advertisements
+		// It goes in front of the agents with the same preference, it was heard last
+		void update(const ICMPRouterEntry& entry) {
+			remove(entry.routerAddress);
+			int position = 0;
+			while (position < _agents.size() && _agents[position].preferenceLevel > entry.preferenceLevel)
+				position++;
+			if (position >= _capacity)
+				return;
+			_agents.insert(_agents.begin() + position, entry);
+			if (_agents.size() > _capacity)
+				_agents.pop_back();
+		}
+
+		// Entry of an agent, 0 if it is not in the cache
+		const ICMPRouterEntry* find(uint32_t routerAddress) const {
+			for (int i = 0; i < _agents.size(); i++)
+				if (_agents[i].routerAddress == routerAddress)
+					return &_agents[i];
+			return 0;
+		}
+
+		bool remove(uint32_t routerAddress) {
+			for (int i = 0; i < _agents.size(); i++)
+				if (_agents[i].routerAddress == routerAddress) {
+					_agents.erase(_agents.begin() + i);
+					return true;
+				}
+			return false;
+		}
+
+		// Best agent other than exclude whose advertisement lifetime has not run out and that
+		// was heard at or after heardSince, 0 if there is none
+		// Expired entries on the way are dropped, older ones stay (another link may have them)
+		const ICMPRouterEntry* best(const Timestamp& now, uint32_t exclude, const Timestamp& heardSince) {
+			for (int i = 0; i < _agents.size(); ) {
+				if (_agents[i].expires <= now) {
+					_agents.erase(_agents.begin() + i);
+					continue;
+				}
+				if (_agents[i].routerAddress != exclude && _agents[i].heard >= heardSince)
+					return &_agents[i];
+				i++;
+			}
+			return 0;
+		}
+
+		void clear() { _agents.clear(); }
+
+	private:
+		int _capacity;
+		Vector<ICMPRouterEntry> _agents;
+};
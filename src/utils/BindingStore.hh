@@ -0,0 +1,361 @@
+// This file contains the persistent store of the mobility bindings and visitors of an agent
+// Every change is appended as a fixed size record to a memory-mapped log file, so a
+// restarted agent replays the log and resumes tunneling without waiting for the mobile
+// nodes to register again. Deadlines are stored in wall clock time: the steady clock of
+// the previous run is meaningless after a restart, and the downtime is subtracted from
+// the remaining lifetimes this way.
+// The log is rewritten with only the live entries when it grows too long (see compactBegin()).
+// Changes survive a crash of the agent process, the page cache is not flushed to disk.
+#pragma once
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/timestamp.hh>
+#include <click/error.hh>
+#include "../structs/MobilityBinding.hh"
+#include "../structs/VisitorEntry.hh"
+#if CLICK_USERLEVEL
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <errno.h>
+# include <string.h>
+#endif
+
+#define BINDINGSTORE_MAGIC 0x4D495053
+#define BINDINGSTORE_VERSION 1
+#define BINDINGSTORE_INITIAL_RECORDS 4096
+#define BINDINGSTORE_COMPACT_STEP 4096	// binding buckets or visitors written per compaction step
+
+enum StoreRecordType {
+	STORE_BINDING_SET = 1,		// binding added or renewed
+	STORE_BINDING_ERASE = 2,	// binding deleted
+	STORE_VISITOR_ADD = 3,		// visitor added, pending unless written by a compaction
+	STORE_VISITOR_ACCEPT = 4,	// visitor accepted by the reply of its home agent
+	STORE_VISITOR_ERASE = 5		// visitor deleted
+};
+
+// Addresses are kept in the byte order of the table they come from:
+// network order for bindings, host order for visitors
+struct StoreRecord {
+	uint8_t type;
+	uint8_t state;
+	uint16_t lifetime;		// binding lifetime or visitor request lifetime
+	uint16_t udpSourcePort;
+	uint16_t padding;
+	uint32_t homeAddress;
+	uint32_t careOfAddress;		// visitor: destination address of the request
+	uint32_t homeAgentAddress;
+	uint32_t padding2;
+	uint64_t identification;	// binding: bits of the reply identification
+	int64_t expires;		// wall clock, in microseconds
+};
+
+class BindingStore {
+	public:
+		BindingStore() : _fd(-1), _map(0), _capacity(0), _compactFd(-1), _compactFrom(0), _compactCount(0) {}
+
+		~BindingStore() { compactAbort(); close(); }
+
+		bool active() const { return _map != 0; }
+
+		// Number of records in the log
+		uint64_t records() const { return _map ? _header()->count : 0; }
+
+		const StoreRecord& record(uint64_t i) const { return _records()[i]; }
+
+		// Open or create the log at path
+		int open(const String& path, ErrorHandler* errh) {
+#if CLICK_USERLEVEL
+			_path = path;
+			_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+			if (_fd < 0)
+				return errh->error("%s: %s", path.c_str(), strerror(errno));
+			struct stat st;
+			if (fstat(_fd, &st) < 0)
+				return errh->error("%s: %s", path.c_str(), strerror(errno));
+			if ((size_t) st.st_size < sizeof(StoreHeader)) {
+				if (_map_file(BINDINGSTORE_INITIAL_RECORDS, errh) < 0)
+					return -1;
+				_header()->magic = BINDINGSTORE_MAGIC;
+				_header()->version = BINDINGSTORE_VERSION;
+				_header()->count = 0;
+				return 0;
+			}
+			uint64_t fileRecords = (st.st_size - sizeof(StoreHeader)) / sizeof(StoreRecord);
+			if (_map_file(fileRecords < BINDINGSTORE_INITIAL_RECORDS ? BINDINGSTORE_INITIAL_RECORDS : fileRecords, errh) < 0)
+				return -1;
+			if (_header()->magic != BINDINGSTORE_MAGIC || _header()->version != BINDINGSTORE_VERSION) {
+				close();
+				return errh->error("%s: not a binding store", path.c_str());
+			}
+			// A record beyond the end of the file was never completely written
+			if (_header()->count > fileRecords)
+				_header()->count = fileRecords;
+			return 0;
+#else
+			(void) path;
+			return errh->error("the binding store is only supported at user level");
+#endif
+		}
+
+		void close() {
+#if CLICK_USERLEVEL
+			if (_map)
+				munmap(_map, _mapSize());
+			if (_fd >= 0)
+				::close(_fd);
+#endif
+			_map = 0;
+			_fd = -1;
+			_capacity = 0;
+		}
+
+		// Append a record, the count is only raised once the record is written
+		// Returns false if the record was dropped because the log is not open (anymore)
+		bool append(const StoreRecord& record) {
+			if (!_map)
+				return false;
+			if (_header()->count == _capacity && _grow() < 0)
+				return false;
+			_records()[_header()->count] = record;
+			__atomic_store_n(&_header()->count, _header()->count + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+
+		/*
+		 * Compaction, the log is replaced with the live entries
+		 * The new log is written next to the old one in as many steps as the caller wants,
+		 * changes appended to the old log meanwhile are copied over by compactEnd()
+		 */
+		bool compacting() const { return _compactFd >= 0; }
+
+		// Start a new log, the live entries are the ones at the current end of the log
+		int compactBegin(ErrorHandler* errh) {
+#if CLICK_USERLEVEL
+			if (!_map || compacting())
+				return 0;
+			String tmpPath = _path + ".tmp";
+			_compactFd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (_compactFd < 0)
+				return errh->error("%s: %s", tmpPath.c_str(), strerror(errno));
+			_compactFrom = _header()->count;
+			_compactCount = 0;
+			// The header is written last, a partial new log is never a valid one
+			if (lseek(_compactFd, sizeof(StoreHeader), SEEK_SET) < 0) {
+				compactAbort();
+				return errh->error("%s: %s", tmpPath.c_str(), strerror(errno));
+			}
+			return 0;
+#else
+			return errh->error("the binding store is only supported at user level");
+#endif
+		}
+
+		// Write live records to the new log
+		int compactWrite(const StoreRecord* records, int n, ErrorHandler* errh) {
+#if CLICK_USERLEVEL
+			if (!compacting())
+				return -1;
+			if (n > 0 && ::write(_compactFd, records, n * sizeof(StoreRecord)) != (ssize_t) (n * sizeof(StoreRecord))) {
+				int err = errno;
+				compactAbort();
+				return errh->error("%s.tmp: %s", _path.c_str(), strerror(err));
+			}
+			_compactCount += n;
+			return 0;
+#else
+			(void) records;
+			(void) n;
+			return errh->error("the binding store is only supported at user level");
+#endif
+		}
+
+		// Copy the changes since compactBegin() and rename the new log over the old one
+		int compactEnd(ErrorHandler* errh) {
+#if CLICK_USERLEVEL
+			if (!compacting())
+				return -1;
+			if (!_map) {
+				compactAbort();
+				return errh->error("%s: closed while compacting", _path.c_str());
+			}
+			uint64_t tail = _header()->count - _compactFrom;
+			if (compactWrite(_records() + _compactFrom, tail, errh) < 0)
+				return -1;
+			StoreHeader header;
+			header.magic = BINDINGSTORE_MAGIC;
+			header.version = BINDINGSTORE_VERSION;
+			header.count = _compactCount;
+			String tmpPath = _path + ".tmp";
+			bool ok = pwrite(_compactFd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+			::close(_compactFd);
+			_compactFd = -1;
+			if (!ok || rename(tmpPath.c_str(), _path.c_str()) < 0) {
+				int err = errno;
+				unlink(tmpPath.c_str());
+				return errh->error("%s: %s", _path.c_str(), strerror(err));
+			}
+			close();
+			return open(_path, errh);
+#else
+			return errh->error("the binding store is only supported at user level");
+#endif
+		}
+
+		void compactAbort() {
+#if CLICK_USERLEVEL
+			if (!compacting())
+				return;
+			::close(_compactFd);
+			_compactFd = -1;
+			unlink((_path + ".tmp").c_str());
+#endif
+		}
+
+		/*
+		 * Records
+		 */
+		static StoreRecord bindingRecord(const MobilityBinding& binding) {
+			StoreRecord record;
+			memset(&record, 0, sizeof(record));
+			record.type = STORE_BINDING_SET;
+			record.lifetime = binding.lifetime;
+			record.homeAddress = binding.homeAddress;
+			record.careOfAddress = binding.careOfAddress;
+			memcpy(&record.identification, &binding.replyIdentification, sizeof(record.identification));
+			record.expires = _toWall(binding.expires);
+			return record;
+		}
+
+		static StoreRecord bindingEraseRecord(uint32_t homeAddress) {
+			StoreRecord record;
+			memset(&record, 0, sizeof(record));
+			record.type = STORE_BINDING_ERASE;
+			record.homeAddress = homeAddress;
+			return record;
+		}
+
+		static StoreRecord visitorRecord(StoreRecordType type, const VisitorEntry& entry) {
+			StoreRecord record;
+			memset(&record, 0, sizeof(record));
+			record.type = type;
+			record.state = entry.state;
+			record.lifetime = entry.requestLifetime;
+			record.udpSourcePort = entry.udpSourcePort;
+			record.homeAddress = entry.sourceIPAddress;
+			record.careOfAddress = entry.destinationIPAddress;
+			record.homeAgentAddress = entry.homeAgentAddress;
+			record.identification = entry.identification;
+			record.expires = _toWall(entry.expires);
+			return record;
+		}
+
+		static StoreRecord visitorAcceptRecord(const VisitorKey& key, uint16_t lifetime, const Timestamp& expires) {
+			StoreRecord record;
+			memset(&record, 0, sizeof(record));
+			record.type = STORE_VISITOR_ACCEPT;
+			record.lifetime = lifetime;
+			record.homeAddress = key.homeAddress;
+			record.identification = key.identification;
+			record.expires = _toWall(expires);
+			return record;
+		}
+
+		static StoreRecord visitorEraseRecord(const VisitorKey& key) {
+			StoreRecord record;
+			memset(&record, 0, sizeof(record));
+			record.type = STORE_VISITOR_ERASE;
+			record.homeAddress = key.homeAddress;
+			record.identification = key.identification;
+			return record;
+		}
+
+		static MobilityBinding binding(const StoreRecord& record) {
+			MobilityBinding binding;
+			binding.homeAddress = record.homeAddress;
+			binding.careOfAddress = record.careOfAddress;
+			binding.lifetime = record.lifetime;
+			memcpy(&binding.replyIdentification, &record.identification, sizeof(record.identification));
+			binding.expires = _toSteady(record.expires);
+			return binding;
+		}
+
+		static VisitorEntry visitor(const StoreRecord& record) {
+			VisitorEntry entry;
+			entry.linkLayerAddress = 0;
+			entry.sourceIPAddress = record.homeAddress;
+			entry.destinationIPAddress = record.careOfAddress;
+			entry.udpSourcePort = record.udpSourcePort;
+			entry.homeAgentAddress = record.homeAgentAddress;
+			entry.identification = record.identification;
+			entry.requestLifetime = record.lifetime;
+			entry.expires = _toSteady(record.expires);
+			entry.state = (VisitorState) record.state;
+			return entry;
+		}
+
+	private:
+		struct StoreHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t count;
+		};
+
+		String _path;
+		int _fd;
+		char* _map;
+		uint64_t _capacity;
+
+		// New log while compacting: its descriptor, the end of the old log when the
+		// compaction started and the records written so far
+		int _compactFd;
+		uint64_t _compactFrom;
+		uint64_t _compactCount;
+
+		StoreHeader* _header() const { return (StoreHeader*) _map; }
+		StoreRecord* _records() const { return (StoreRecord*) (_map + sizeof(StoreHeader)); }
+		size_t _mapSize() const { return sizeof(StoreHeader) + _capacity * sizeof(StoreRecord); }
+
+		// Convert between the steady clock of this run and the wall clock
+		static int64_t _toWall(const Timestamp& steady) {
+			return (Timestamp::now() + (steady - Timestamp::now_steady())).usecval();
+		}
+
+		static Timestamp _toSteady(int64_t wall) {
+			return Timestamp::now_steady() + (Timestamp::make_usec(wall) - Timestamp::now());
+		}
+
+		int _map_file(uint64_t capacity, ErrorHandler* errh) {
+#if CLICK_USERLEVEL
+			size_t size = sizeof(StoreHeader) + capacity * sizeof(StoreRecord);
+			if (ftruncate(_fd, size) < 0)
+				return errh->error("%s: %s", _path.c_str(), strerror(errno));
+			void* map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+			if (map == MAP_FAILED)
+				return errh->error("%s: %s", _path.c_str(), strerror(errno));
+			_map = (char*) map;
+			_capacity = capacity;
+			return 0;
+#else
+			(void) capacity;
+			return errh->error("the binding store is only supported at user level");
+#endif
+		}
+
+		// Double the size of the log file
+		// On failure the log is closed, the records written so far stay in the file
+		int _grow() {
+#if CLICK_USERLEVEL
+			munmap(_map, _mapSize());
+			_map = 0;
+			if (_map_file(2 * _capacity, ErrorHandler::default_handler()) < 0) {
+				close();
+				return -1;
+			}
+			return 0;
+#else
+			return -1;
+#endif
+		}
+};
@@ -0,0 +1,309 @@
+// This file contains the table of mobility bindings kept at the home agent
+// The table is split in shards by home address hash, every shard is a chained hash table.
+// Readers on the forwarding path never take a lock: a binding is published as an immutable
+// node and a writer that replaces or removes a node only frees it once every reader that
+// could still see it has left its read section (epoch based reclamation).
+// Writers serialize per shard on a spinlock.
+#pragma once
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+#include <click/sync.hh>
+#include "../structs/MobilityBinding.hh"
+
+#define BINDINGTABLE_MAX_READERS 64
+#define BINDINGTABLE_INITIAL_BUCKETS 64
+
+class BindingTable {
+	public:
+		BindingTable() : _shards(0), _shardMask(0), _shardBits(0), _epoch(1), _readers(0) {
+			for (int i = 0; i < BINDINGTABLE_MAX_READERS; i++)
+				_readerEpochs[i].epoch = OFFLINE;
+			setShards(1);
+		}
+
+		~BindingTable() {
+			for (unsigned i = 0; i <= _shardMask; i++) {
+				_reclaim(_shards[i], ~(uint64_t) 0);
+				Buckets* buckets = _shards[i].buckets;
+				for (unsigned b = 0; b <= buckets->mask; b++) {
+					Node* node = buckets->heads[b];
+					while (node) {
+						Node* next = node->next;
+						delete node;
+						node = next;
+					}
+				}
+				delete[] (char*) buckets;
+			}
+			delete[] _shards;
+		}
+
+		// Split the table in a power of two number of shards
+		// Only allowed while the table is empty and no reader is active
+		void setShards(unsigned count) {
+			unsigned bits = 0;
+			while ((1U << bits) < count)
+				bits++;
+			if (_shards) {
+				for (unsigned i = 0; i <= _shardMask; i++)
+					delete[] (char*) _shards[i].buckets;
+				delete[] _shards;
+			}
+			_shardBits = bits;
+			_shardMask = (1U << bits) - 1;
+			_shards = new Shard[_shardMask + 1];
+			for (unsigned i = 0; i <= _shardMask; i++) {
+				_shards[i].buckets = _makeBuckets(BINDINGTABLE_INITIAL_BUCKETS);
+				_shards[i].size = 0;
+			}
+		}
+
+		unsigned shards() const { return _shardMask + 1; }
+
+		// Shard which holds the binding of homeAddress (see ShardSwitch)
+		unsigned shardOf(IPAddress homeAddress) const { return _hash(homeAddress) & _shardMask; }
+
+		// Reserve a reader slot, returns -1 if all slots are taken
+		// Must be called before the reader runs (e.g. in initialize())
+		int addReader() {
+			if (_readers >= BINDINGTABLE_MAX_READERS)
+				return -1;
+			return _readers++;
+		}
+
+		/*
+		 * Reader side, may run on any thread
+		 */
+		// Bindings returned by lookup() are only valid between readBegin() and readEnd()
+		void readBegin(int reader) {
+			__atomic_store_n(&_readerEpochs[reader].epoch, __atomic_load_n(&_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		}
+
+		void readEnd(int reader) {
+			__atomic_store_n(&_readerEpochs[reader].epoch, OFFLINE, __ATOMIC_RELEASE);
+		}
+
+		const MobilityBinding* lookup(IPAddress homeAddress) const {
+			uint32_t hash = _hash(homeAddress);
+			const Shard& shard = _shards[hash & _shardMask];
+			const Buckets* buckets = __atomic_load_n(&shard.buckets, __ATOMIC_ACQUIRE);
+			const Node* node = __atomic_load_n(&buckets->heads[(hash >> _shardBits) & buckets->mask], __ATOMIC_ACQUIRE);
+			while (node) {
+				if (node->binding.homeAddress == homeAddress.addr())
+					return &node->binding;
+				node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+			}
+			return 0;
+		}
+
+		bool empty() const { return size() == 0; }
+
+		int size() const {
+			int total = 0;
+			for (unsigned i = 0; i <= _shardMask; i++)
+				total += __atomic_load_n(&_shards[i].size, __ATOMIC_RELAXED);
+			return total;
+		}
+
+		/*
+		 * Writer side
+		 */
+		// Publish a new version of the binding for binding.homeAddress
+		void set(const MobilityBinding& binding) {
+			uint32_t hash = _hash(IPAddress(binding.homeAddress));
+			Shard& shard = _shards[hash & _shardMask];
+			shard.lock.acquire();
+			Buckets* buckets = shard.buckets;
+			Node** link = &buckets->heads[(hash >> _shardBits) & buckets->mask];
+			while (*link && (*link)->binding.homeAddress != binding.homeAddress)
+				link = &(*link)->next;
+			Node* node = new Node;
+			node->binding = binding;
+			if (*link) {
+				// Replace the old version, readers on it still see the rest of the chain
+				Node* old = *link;
+				node->next = old->next;
+				__atomic_store_n(link, node, __ATOMIC_RELEASE);
+				_retire(shard, old, 0);
+			} else {
+				node->next = buckets->heads[(hash >> _shardBits) & buckets->mask];
+				__atomic_store_n(&buckets->heads[(hash >> _shardBits) & buckets->mask], node, __ATOMIC_RELEASE);
+				__atomic_store_n(&shard.size, shard.size + 1, __ATOMIC_RELAXED);
+				if ((unsigned) shard.size > 2 * (buckets->mask + 1))
+					_grow(shard);
+			}
+			_reclaim(shard, _minReaderEpoch());
+			shard.lock.release();
+		}
+
+		// Remove the binding for homeAddress, returns false if there was none
+		bool erase(IPAddress homeAddress) {
+			uint32_t hash = _hash(homeAddress);
+			Shard& shard = _shards[hash & _shardMask];
+			shard.lock.acquire();
+			Buckets* buckets = shard.buckets;
+			Node** link = &buckets->heads[(hash >> _shardBits) & buckets->mask];
+			while (*link && (*link)->binding.homeAddress != homeAddress.addr())
+				link = &(*link)->next;
+			Node* old = *link;
+			if (old) {
+				__atomic_store_n(link, old->next, __ATOMIC_RELEASE);
+				__atomic_store_n(&shard.size, shard.size - 1, __ATOMIC_RELAXED);
+				_retire(shard, old, 0);
+			}
+			_reclaim(shard, _minReaderEpoch());
+			shard.lock.release();
+			return old != 0;
+		}
+
+		// Call f(binding, data) for every binding, on the writer side
+		template <typename F>
+		void forEach(F f, void* data) {
+			for (unsigned i = 0; i <= _shardMask; i++) {
+				Shard& shard = _shards[i];
+				shard.lock.acquire();
+				for (unsigned b = 0; b <= shard.buckets->mask; b++)
+					for (Node* node = shard.buckets->heads[b]; node; node = node->next)
+						f(node->binding, data);
+				shard.lock.release();
+			}
+		}
+
+		// Call f(binding, data) for the bindings of at most count buckets from cursor on, on the
+		// writer side. A walk starts with cursor 0 and ends when false is returned.
+		// Buckets only split in two when a shard grows, so a walk in several steps visits every
+		// binding that is in the table during the whole walk at least once
+		template <typename F>
+		bool forEachStep(uint64_t& cursor, unsigned count, F f, void* data) {
+			unsigned i = cursor >> 32;
+			unsigned b = (uint32_t) cursor;
+			while (i <= _shardMask && count > 0) {
+				Shard& shard = _shards[i];
+				shard.lock.acquire();
+				for (; b <= shard.buckets->mask && count > 0; b++, count--)
+					for (Node* node = shard.buckets->heads[b]; node; node = node->next)
+						f(node->binding, data);
+				bool done = b > shard.buckets->mask;
+				shard.lock.release();
+				if (done) {
+					i++;
+					b = 0;
+				}
+			}
+			cursor = ((uint64_t) i << 32) | b;
+			return i <= _shardMask;
+		}
+
+	private:
+		static const uint64_t OFFLINE = ~(uint64_t) 0;
+
+		struct Node {
+			MobilityBinding binding;
+			Node* next;
+		};
+
+		struct Buckets {
+			unsigned mask;
+			Node* heads[1];
+		};
+
+		// Node or bucket array that was unlinked at a given epoch
+		struct Retired {
+			uint64_t epoch;
+			Node* node;
+			Buckets* buckets;
+		};
+
+		struct Shard {
+			Buckets* buckets;
+			int size;
+			Spinlock lock;
+			Vector<Retired> retired;
+		};
+
+		// Padded to a cache line so readers on different threads do not share one
+		struct ReaderEpoch {
+			uint64_t epoch;
+			char padding[64 - sizeof(uint64_t)];
+		};
+
+		Shard* _shards;
+		unsigned _shardMask;
+		unsigned _shardBits;
+		uint64_t _epoch;
+		int _readers;
+		ReaderEpoch _readerEpochs[BINDINGTABLE_MAX_READERS];
+
+		static uint32_t _hash(IPAddress address) {
+			uint32_t hash = address.addr();
+			hash ^= hash >> 16;
+			hash *= 0x85ebca6b;
+			hash ^= hash >> 13;
+			hash *= 0xc2b2ae35;
+			hash ^= hash >> 16;
+			return hash;
+		}
+
+		static Buckets* _makeBuckets(unsigned count) {
+			char* memory = new char[sizeof(Buckets) + (count - 1) * sizeof(Node*)];
+			Buckets* buckets = (Buckets*) memory;
+			buckets->mask = count - 1;
+			for (unsigned i = 0; i < count; i++)
+				buckets->heads[i] = 0;
+			return buckets;
+		}
+
+		// Double the bucket array of a shard
+		// Nodes are copied, readers still walking the old array keep valid chains
+		void _grow(Shard& shard) {
+			Buckets* old = shard.buckets;
+			Buckets* buckets = _makeBuckets(2 * (old->mask + 1));
+			for (unsigned b = 0; b <= old->mask; b++) {
+				for (Node* node = old->heads[b]; node; node = node->next) {
+					Node* copy = new Node;
+					copy->binding = node->binding;
+					unsigned index = (_hash(IPAddress(node->binding.homeAddress)) >> _shardBits) & buckets->mask;
+					copy->next = buckets->heads[index];
+					buckets->heads[index] = copy;
+					_retire(shard, node, 0);
+				}
+			}
+			__atomic_store_n(&shard.buckets, buckets, __ATOMIC_RELEASE);
+			_retire(shard, 0, old);
+		}
+
+		void _retire(Shard& shard, Node* node, Buckets* buckets) {
+			Retired retired;
+			retired.epoch = __atomic_fetch_add(&_epoch, 1, __ATOMIC_SEQ_CST);
+			retired.node = node;
+			retired.buckets = buckets;
+			shard.retired.push_back(retired);
+		}
+
+		// Lowest epoch of the readers that are inside a read section
+		uint64_t _minReaderEpoch() {
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			uint64_t min = OFFLINE;
+			for (int i = 0; i < _readers; i++) {
+				uint64_t epoch = __atomic_load_n(&_readerEpochs[i].epoch, __ATOMIC_SEQ_CST);
+				if (epoch < min)
+					min = epoch;
+			}
+			return min;
+		}
+
+		// Free what was retired before every active reader entered its read section
+		void _reclaim(Shard& shard, uint64_t minEpoch) {
+			int kept = 0;
+			for (int i = 0; i < shard.retired.size(); i++) {
+				Retired& retired = shard.retired[i];
+				if (retired.epoch < minEpoch) {
+					delete retired.node;
+					delete[] (char*) retired.buckets;
+				} else
+					shard.retired[kept++] = retired;
+			}
+			shard.retired.resize(kept);
+		}
+};
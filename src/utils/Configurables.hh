@@ -4,6 +4,14 @@
 #define PRINTDEBUG false
 #define PRINTERROR true
 
+// Per-path cycle histograms in the agent elements (see utils/PathStats.hh)
+// false compiles the instrumentation and its handlers out
+#define PATHSTATS true
+
+// Binary trace of the mobility state transitions (see utils/EventTrace.hh)
+// false compiles the TRACE_EVENT calls out
+#define EVENTTRACE true
+
 const IPAddress broadCast = IPAddress("255.255.255.255");
 
 /* ====================
@@ -45,6 +53,12 @@ const IPAddress SolicitationAddress = broadCast;
 const unsigned int maxLifetimeForeignAgent = 1800; // seconds
 const unsigned int maxLifetimeHomeAgent = maxLifetimeForeignAgent;
 
+// Seconds a pending request waits for the reply of the home agent at the FA
+const unsigned int maxPendingTimeForeignAgent = 7;
+
+// Pending requests kept per mobile node at the FA, older ones are dropped
+const unsigned int maxPendingPerVisitor = 4;
+
 // Extension related configurables
 const unsigned int registrationLifetime = 60; // seconds
 
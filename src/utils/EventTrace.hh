@@ -0,0 +1,129 @@
+// This file contains the event trace: fixed-size records of the mobility state transitions
+// (structs/TraceRecord.hh) in a ring per thread. A thread only writes its own ring, so
+// recording takes no lock: the record is written first, then the head of the ring is
+// published with a release store. A reader copies a ring and drops the records that were
+// overwritten while it copied. The rings are shared by the whole process, an EventTracer
+// element reads and dumps them. With EVENTTRACE false (Configurables.hh) TRACE_EVENT is empty.
+#pragma once
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <click/element.hh>
+#include <click/timestamp.hh>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// Local imports
+#include "Configurables.hh"
+#include "../structs/TraceRecord.hh"
+
+// Records per ring, a power of two
+#define EVENTTRACE_RING 4096
+
+#if EVENTTRACE
+#define TRACE_EVENT(element, type, address, peer, identification, value) \
+	EventTrace::instance().record(element, type, address, peer, identification, value)
+#else
+#define TRACE_EVENT(element, type, address, peer, identification, value)
+#endif
+
+class EventTrace {
+	public:
+		static EventTrace& instance() {
+			static EventTrace trace;
+			return trace;
+		}
+
+		void record(const Element* e, uint16_t type, uint32_t address, uint32_t peer, uint64_t identification, uint16_t value) {
+			int thread = click_current_cpu_id();
+			Ring& ring = _rings[thread];
+			uint64_t head = ring.head;
+			TraceRecord& record = ring.records[head & (EVENTTRACE_RING - 1)];
+			record.time = Timestamp::now_steady().nsecval();
+			record.identification = identification;
+			record.address = address;
+			record.peer = peer;
+			record.type = type;
+			record.value = value;
+			record.thread = thread;
+			record.element = e->eindex();
+			__atomic_store_n(&ring.head, head + 1, __ATOMIC_RELEASE);
+		}
+
+		// Events recorded since the start, also the overwritten ones
+		uint64_t count() const {
+			uint64_t total = 0;
+			for (int i = 0; i < _nrings; i++)
+				total += __atomic_load_n(&_rings[i].head, __ATOMIC_ACQUIRE);
+			return total;
+		}
+
+		// Append the events in the rings, oldest first per ring
+		void snapshot(Vector<TraceRecord>& records) const {
+			for (int i = 0; i < _nrings; i++) {
+				const Ring& ring = _rings[i];
+				uint64_t head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+				uint64_t first = head > EVENTTRACE_RING ? head - EVENTTRACE_RING : 0;
+				int start = records.size();
+				for (uint64_t j = first; j < head; j++)
+					records.push_back(ring.records[j & (EVENTTRACE_RING - 1)]);
+				// The writer went on meanwhile, its new records replaced the oldest copied ones
+				// The slot of record now may already be half written, it counts as replaced
+				uint64_t now = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE) + 1;
+				uint64_t overwritten = now > first + EVENTTRACE_RING ? now - first - EVENTTRACE_RING : 0;
+				if (overwritten > head - first)
+					overwritten = head - first;
+				if (overwritten)
+					records.erase(records.begin() + start, records.begin() + start + overwritten);
+			}
+		}
+
+		// Write a dump (see structs/TraceRecord.hh) to fd, false on a write error
+		// It only calls write(), so a signal handler can dump the rings
+		// A ring is not copied first, a record written during the dump may be torn
+		bool dump(int fd, const char* names, uint32_t namesLength) const {
+			TraceDumpHeader header;
+			memcpy(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic));
+			header.version = TRACE_DUMP_VERSION;
+			header.rings = _nrings;
+			header.ringSize = EVENTTRACE_RING;
+			header.namesLength = namesLength;
+			if (!_write(fd, &header, sizeof(header)) || !_write(fd, names, namesLength))
+				return false;
+			for (int i = 0; i < _nrings; i++) {
+				uint64_t head = __atomic_load_n(&_rings[i].head, __ATOMIC_ACQUIRE);
+				if (!_write(fd, &head, sizeof(head)) || !_write(fd, _rings[i].records, sizeof(_rings[i].records)))
+					return false;
+			}
+			return true;
+		}
+
+	private:
+		struct Ring {
+			uint64_t head;
+			TraceRecord records[EVENTTRACE_RING];
+		};
+
+		// The rings live as long as the process, a crash dump may need them at any time
+		EventTrace(): _nrings(click_max_cpu_ids()) {
+			_rings = new Ring[_nrings];
+			memset(_rings, 0, sizeof(Ring) * _nrings);
+		}
+
+		static bool _write(int fd, const void* data, size_t length) {
+			const char* p = (const char*) data;
+			while (length > 0) {
+				ssize_t written = write(fd, p, length);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return false;
+				p += written;
+				length -= written;
+			}
+			return true;
+		}
+
+		Ring* _rings;
+		int _nrings;
+};
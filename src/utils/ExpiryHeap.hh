@@ -0,0 +1,126 @@
+// This file contains a min-heap of absolute expiry deadlines
+// It is used to expire lifetime limited entries (bindings, visitors) without
+// touching every entry each second: only the entries that actually expire are visited
+// Every key has at most one entry: the heap keeps the position of every key, so a renewal
+// moves the entry of its key and a deleted key takes its entry out. The heap holds one
+// entry per live key, however often the keys are renewed.
+#pragma once
+#include <click/timestamp.hh>
+#include <click/vector.hh>
+#include <click/hashtable.hh>
+
+template <typename K>
+class ExpiryHeap {
+	public:
+		bool empty() const { return _heap.empty(); }
+		int size() const { return _heap.size(); }
+
+		// Earliest deadline in the heap, only valid if the heap is not empty
+		const Timestamp& nextDeadline() const { return _heap[0].deadline; }
+
+		// Set the deadline of key, a key that is already in the heap is moved
+		void schedule(const K& key, const Timestamp& deadline){
+			int* position = _positions.get_pointer(key);
+			if (position) {
+				int i = *position;
+				bool earlier = deadline < _heap[i].deadline;
+				_heap[i].deadline = deadline;
+				if (earlier)
+					_siftUp(i);
+				else
+					_siftDown(i);
+				return;
+			}
+			Entry entry;
+			entry.deadline = deadline;
+			entry.key = key;
+			_heap.push_back(entry);
+			_positions.set(key, _heap.size() - 1);
+			_siftUp(_heap.size() - 1);
+		}
+
+		// Take the entry of key out, e.g. when its entry is deleted
+		// Returns false if key has no entry
+		bool cancel(const K& key){
+			int* position = _positions.get_pointer(key);
+			if (!position)
+				return false;
+			_remove(*position);
+			return true;
+		}
+
+		// Pop the earliest entry if its deadline is not later than now
+		// Returns false if nothing has expired yet
+		bool popExpired(const Timestamp& now, K& key, Timestamp& deadline){
+			if (_heap.empty() || now < _heap[0].deadline)
+				return false;
+			key = _heap[0].key;
+			deadline = _heap[0].deadline;
+			_remove(0);
+			return true;
+		}
+
+		void clear(){
+			_heap.clear();
+			_positions.clear();
+		}
+
+	private:
+		struct Entry {
+			Timestamp deadline;
+			K key;
+		};
+		Vector<Entry> _heap;
+
+		// Position of every key in _heap
+		HashTable<K, int> _positions;
+
+		// Remove the entry at position i, the last entry takes its place
+		void _remove(int i){
+			_positions.erase(_heap[i].key);
+			int last = _heap.size() - 1;
+			if (i != last) {
+				_heap[i] = _heap[last];
+				_positions.set(_heap[i].key, i);
+			}
+			_heap.pop_back();
+			if (i < _heap.size()) {
+				_siftUp(i);
+				_siftDown(i);
+			}
+		}
+
+		void _place(int i, const Entry& entry){
+			_heap[i] = entry;
+			_positions.set(entry.key, i);
+		}
+
+		void _siftUp(int i){
+			Entry entry = _heap[i];
+			while (i > 0) {
+				int parent = (i - 1) / 2;
+				if (!(entry.deadline < _heap[parent].deadline))
+					break;
+				_place(i, _heap[parent]);
+				i = parent;
+			}
+			_place(i, entry);
+		}
+
+		void _siftDown(int i){
+			Entry entry = _heap[i];
+			int n = _heap.size();
+			while (true) {
+				int child = 2 * i + 1;
+				if (child >= n)
+					break;
+				if (child + 1 < n && _heap[child + 1].deadline < _heap[child].deadline)
+					child++;
+				if (!(_heap[child].deadline < entry.deadline))
+					break;
+				_place(i, _heap[child]);
+				i = child;
+			}
+			_place(i, entry);
+		}
+};
@@ -1,6 +1,10 @@
 // This file contains certain helper functions used in the project
+#pragma once
 #include <stdint.h>
+#include <click/packet.hh>
+#include <clicknet/ip.h>
 #include "Configurables.hh"
+#include "../structs/MobilityBinding.hh"
 
 #if PRINTDEBUG
 	#define LOG(...) click_chatter(__VA_ARGS__)
@@ -29,3 +33,82 @@ inline bool sameNetwork(IPAddress ip1, IPAddress ip2) {
 	IPAddress mask = IPAddress("255.255.255.0");
 	return ip1.matches_prefix(ip2, mask);
 }
+
+// Index of the care of address a mobile node uses among count advertised ones, the same
+// for every advertisement so the mobile nodes of an agent stay spread over its addresses
+// With weights, an address of weight w gets w shares of the mobile nodes (weight 0: none)
+inline int careOfAddressIndex(IPAddress homeAddress, int count, const uint8_t* weights = 0) {
+	uint32_t hash = homeAddress.addr();
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	if (count <= 0)
+		return 0;
+	unsigned total = 0;
+	for (int i = 0; weights && i < count; i++)
+		total += weights[i];
+	if (!total)
+		return hash % count;
+	unsigned share = hash % total;
+	for (int i = 0; i < count; i++) {
+		if (share < weights[i])
+			return i;
+		share -= weights[i];
+	}
+	return 0;
+}
+
+// Update a checksum after a 16-bit field changed from oldValue to newValue (RFC1624, eqn. 3)
+// The values are taken as they are in the packet, one's complement sums do not depend on byte order
+inline uint16_t updateChecksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue) {
+	uint32_t sum = (~checksum & 0xFFFF) + (~oldValue & 0xFFFF) + newValue;
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	return ~sum & 0xFFFF;
+}
+
+// Build the outer IP header template of the tunnel from tunnelSource to the care of address of the binding
+// ip_tos, ip_len and ip_sum are filled in per packet, the sum of the other fields is kept in the binding
+inline void buildTunnelHeader(MobilityBinding& binding, IPAddress tunnelSource) {
+	click_ip* outerIP = &binding.tunnelHeader;
+	memset(outerIP, 0, sizeof(click_ip));
+	outerIP->ip_v = 4;
+	outerIP->ip_hl = sizeof(click_ip) >> 2;
+	outerIP->ip_p = 4;
+	outerIP->ip_off = 0;
+	outerIP->ip_ttl = 64;
+	outerIP->ip_src = tunnelSource.in_addr();
+	outerIP->ip_dst = IPAddress(binding.careOfAddress).in_addr();
+	binding.tunnelHeaderSum = ~click_in_cksum((unsigned char *)outerIP, sizeof(click_ip)) & 0xFFFF;
+}
+
+// Encapsulate the IP packet in the outer IP header cached in the binding according RFC2003
+// Returns the encapsulated packet, or 0 if it could not be allocated
+inline WritablePacket* encapIPinIP(Packet* p, const MobilityBinding& binding) {
+	click_ip* innerIP = (click_ip *) p->data();
+	// Undo the TTL decrement of the forwarding path, the checksum is updated incrementally (RFC1624)
+	innerIP->ip_ttl++;
+	uint32_t sum = (~innerIP->ip_sum & 0xFFFF) + htons(0x0100);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	innerIP->ip_sum = ~sum & 0xFFFF;
+	p->set_ip_header(innerIP, sizeof(click_ip));
+	// Create new packet with place for outer IP header
+	WritablePacket* newPacket = p->push(sizeof(click_ip));
+	if (!newPacket)
+		return 0;
+	click_ip* outerIP = reinterpret_cast<click_ip *>(newPacket->data());
+	innerIP = reinterpret_cast<click_ip *>(newPacket->data() + sizeof(click_ip));
+	memcpy(outerIP, &binding.tunnelHeader, sizeof(click_ip));
+	outerIP->ip_tos = innerIP->ip_tos;
+	outerIP->ip_len = htons(newPacket->length());
+	// Only ip_tos and ip_len differ from the template, add them to its sum
+	sum = binding.tunnelHeaderSum + htons(outerIP->ip_tos) + outerIP->ip_len;
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	outerIP->ip_sum = ~sum & 0xFFFF;
+	newPacket->set_dst_ip_anno(IPAddress(outerIP->ip_dst));
+	newPacket->set_ip_header(outerIP, sizeof(click_ip));
+	return newPacket;
+}
@@ -0,0 +1,119 @@
+// This file contains a histogram of latencies, in microseconds or cycles
+// Buckets are log-linear: every power of two is split in 8 buckets, so a percentile
+// is reported within 12.5% of the real value while add() stays a few instructions.
+#pragma once
+#include <click/glue.hh>
+
+#define LATENCYHISTOGRAM_SUB_BITS 3
+#define LATENCYHISTOGRAM_BUCKETS ((64 - LATENCYHISTOGRAM_SUB_BITS + 1) << LATENCYHISTOGRAM_SUB_BITS)
+
+// Values reported by the read handlers of a histogram, see stat() and statName()
+enum HistogramStat { HISTOGRAM_COUNT, HISTOGRAM_AVG, HISTOGRAM_P50, HISTOGRAM_P99, HISTOGRAM_P999, HISTOGRAM_MAX, HISTOGRAM_STATS };
+
+class LatencyHistogram {
+	public:
+		LatencyHistogram() { clear(); }
+
+		void clear() {
+			for (int i = 0; i < LATENCYHISTOGRAM_BUCKETS; i++)
+				_buckets[i] = 0;
+			_count = 0;
+			_total = 0;
+			_max = 0;
+		}
+
+		void add(uint64_t usec) {
+			_buckets[_index(usec)]++;
+			_count++;
+			_total += usec;
+			if (usec > _max)
+				_max = usec;
+		}
+
+		// Add n samples of the same value, e.g. the average of a batch of n packets
+		void add(uint64_t usec, uint64_t n) {
+			_buckets[_index(usec)] += n;
+			_count += n;
+			_total += usec * n;
+			if (usec > _max)
+				_max = usec;
+		}
+
+		// Add the samples of another histogram, e.g. the one of another thread
+		void merge(const LatencyHistogram& other) {
+			for (int i = 0; i < LATENCYHISTOGRAM_BUCKETS; i++)
+				_buckets[i] += other._buckets[i];
+			_count += other._count;
+			_total += other._total;
+			if (other._max > _max)
+				_max = other._max;
+		}
+
+		uint64_t count() const { return _count; }
+		uint64_t max() const { return _max; }
+		uint64_t average() const { return _count ? _total / _count : 0; }
+
+		// Upper bound of the bucket that holds the given percentile (0..100)
+		uint64_t percentile(double p) const {
+			if (_count == 0)
+				return 0;
+			uint64_t rank = (uint64_t) (p / 100 * _count);
+			if (rank >= _count)
+				rank = _count - 1;
+			uint64_t seen = 0;
+			for (int i = 0; i < LATENCYHISTOGRAM_BUCKETS; i++) {
+				seen += _buckets[i];
+				if (seen > rank)
+					return _upper(i) < _max ? _upper(i) : _max;
+			}
+			return _max;
+		}
+
+		uint64_t stat(int stat) const {
+			switch (stat) {
+				case HISTOGRAM_COUNT:
+					return count();
+				case HISTOGRAM_AVG:
+					return average();
+				case HISTOGRAM_P50:
+					return percentile(50);
+				case HISTOGRAM_P99:
+					return percentile(99);
+				case HISTOGRAM_P999:
+					return percentile(99.9);
+				default:
+					return max();
+			}
+		}
+
+		// Suffixes of the handler names, in HistogramStat order
+		static const char* statName(int stat) {
+			static const char* const names[] = { "count", "avg", "p50", "p99", "p999", "max" };
+			return names[stat];
+		}
+
+	private:
+		uint64_t _buckets[LATENCYHISTOGRAM_BUCKETS];
+		uint64_t _count;
+		uint64_t _total;
+		uint64_t _max;
+
+		static const unsigned SUB = 1 << LATENCYHISTOGRAM_SUB_BITS;
+
+		static unsigned _index(uint64_t value) {
+			if (value < SUB)
+				return value;
+			unsigned msb = 63 - __builtin_clzll(value);
+			unsigned sub = (value >> (msb - LATENCYHISTOGRAM_SUB_BITS)) & (SUB - 1);
+			return (msb - LATENCYHISTOGRAM_SUB_BITS + 1) * SUB + sub;
+		}
+
+		static uint64_t _upper(unsigned index) {
+			if (index < SUB)
+				return index;
+			unsigned msb = index / SUB + LATENCYHISTOGRAM_SUB_BITS - 1;
+			uint64_t sub = index % SUB;
+			uint64_t lower = ((uint64_t) 1 << msb) | (sub << (msb - LATENCYHISTOGRAM_SUB_BITS));
+			return lower + ((uint64_t) 1 << (msb - LATENCYHISTOGRAM_SUB_BITS)) - 1;
+		}
+};
@@ -0,0 +1,74 @@
+// This file contains the counters of the agent and mobile node elements and the interface
+// through which a MetricsExporter collects them.
+// Every thread counts in its own row of a MetricCounters, padded to a cache line, so the
+// forwarding path needs no atomics or locks. A read sums the rows; a count of another
+// thread may show up one read later, good enough for statistics.
+// Elements that export metrics derive from MetricsSource and return it from cast().
+#pragma once
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <click/element.hh>
+#include <click/straccum.hh>
+#include <stdlib.h>
+#include <string.h>
+
+class MetricCounters {
+	public:
+		MetricCounters(): _stride(0), _size(0), _counters(0) {}
+		~MetricCounters() { free(_counters); }
+
+		// Allocate the counters, call from configure()
+		void initialize(int counters) {
+			// A row is a whole number of cache lines and starts on one
+			int perLine = CLICK_CACHE_LINE_SIZE / sizeof(uint64_t);
+			_stride = (counters + perLine - 1) / perLine * perLine;
+			_size = _stride * click_max_cpu_ids();
+			free(_counters);
+			void* memory = 0;
+			if (posix_memalign(&memory, CLICK_CACHE_LINE_SIZE, _size * sizeof(uint64_t)) != 0)
+				memory = 0;
+			_counters = (uint64_t*) memory;
+			if (_counters)
+				memset(_counters, 0, _size * sizeof(uint64_t));
+			else
+				_size = 0;
+		}
+
+		void add(int counter, uint64_t n = 1) {
+			_counters[click_current_cpu_id() * _stride + counter] += n;
+		}
+
+		// Count of all threads
+		uint64_t value(int counter) const {
+			uint64_t total = 0;
+			for (int i = counter; i < _size; i += _stride)
+				total += _counters[i];
+			return total;
+		}
+
+	private:
+		int _stride;
+		int _size;
+		uint64_t* _counters;
+
+		MetricCounters(const MetricCounters&);
+		MetricCounters& operator=(const MetricCounters&);
+};
+
+class MetricsSource {
+	public:
+		virtual ~MetricsSource() {}
+
+		// Append the metrics of this element, one writeMetric per sample
+		virtual void writeMetrics(StringAccum&) const = 0;
+
+		// Write one sample in the Prometheus text format:
+		// mobileip_<name>{element="<element>",<labels>} <value>
+		// Counters end on _total, other names are gauges
+		static void writeMetric(StringAccum& sa, const Element* e, const char* name, uint64_t value, const String& labels = String()) {
+			sa << "mobileip_" << name << "{element=\"" << e->name() << "\"";
+			if (labels)
+				sa << ',' << labels;
+			sa << "} " << value << '\n';
+		}
+};
@@ -0,0 +1,66 @@
+// This file contains per-thread cycle histograms for the paths through an element
+// A path is timed with the TSC (click_get_cycles), around its code and the elements
+// downstream in the same push. Every thread records in its own histograms, the read
+// handlers merge them. With PATHSTATS false (Configurables.hh) the macros are empty.
+// A path that handles packets in batches records the average of a batch once per packet
+// (PATHSTATS_RECORD_BATCH): the count and the average are per packet, but the percentiles
+// and the maximum are those of the batch averages, a slow packet in a batch is not seen.
+#pragma once
+#include <click/glue.hh>
+#include <click/vector.hh>
+
+// Local imports
+#include "LatencyHistogram.hh"
+#include "Configurables.hh"
+
+#if PATHSTATS
+#define PATHSTATS_START(start) click_cycles_t start = click_get_cycles()
+#define PATHSTATS_RECORD(stats, path, start) (stats).add(path, click_get_cycles() - (start))
+#define PATHSTATS_RECORD_BATCH(stats, path, start, n) (stats).add(path, (click_get_cycles() - (start)) / (n), n)
+#else
+#define PATHSTATS_START(start)
+#define PATHSTATS_RECORD(stats, path, start)
+#define PATHSTATS_RECORD_BATCH(stats, path, start, n)
+#endif
+
+class PathStats {
+	public:
+		PathStats(): _paths(0) {}
+
+		// Allocate the histograms, call from initialize()
+		void initialize(int paths) {
+			_paths = paths;
+			_histograms.resize(paths * click_max_cpu_ids());
+		}
+
+		void add(int path, click_cycles_t cycles) {
+			_histograms[click_current_cpu_id() * _paths + path].add(cycles);
+		}
+
+		// n samples of cycles, see PATHSTATS_RECORD_BATCH
+		void add(int path, click_cycles_t cycles, uint64_t n) {
+			_histograms[click_current_cpu_id() * _paths + path].add(cycles, n);
+		}
+
+		// Samples of one path over all threads
+		LatencyHistogram merged(int path) const {
+			LatencyHistogram histogram;
+			for (int i = path; i < _histograms.size(); i += _paths)
+				histogram.merge(_histograms[i]);
+			return histogram;
+		}
+
+		uint64_t stat(int path, int stat) const {
+			return merged(path).stat(stat);
+		}
+
+		// Samples recorded while clearing are lost, good enough for statistics
+		void clear() {
+			for (int i = 0; i < _histograms.size(); i++)
+				_histograms[i].clear();
+		}
+
+	private:
+		int _paths;
+		Vector<LatencyHistogram> _histograms;
+};
@@ -0,0 +1,216 @@
+// This file contains the visitor list kept at the foreign agent
+// Entries are indexed by (home address, identification), a second index keeps the
+// identifications per home address, so relaying a reply does not depend on the number of visitors.
+// Registration handling (Registrar) writes the list, the decapsulation path of the
+// RoutingElement reads it, possibly on another thread. Both serialize on a spinlock,
+// the critical sections are short.
+#pragma once
+#include <click/hashtable.hh>
+#include <click/vector.hh>
+#include <click/sync.hh>
+#include "../structs/VisitorEntry.hh"
+
+class VisitorTable {
+	public:
+		VisitorTable() : _pending(0), _evicted(0) {}
+
+		int size() const { return _visitors.size(); }
+
+		// Number of entries still waiting for the reply of the home agent
+		int pending() const { return _pending; }
+
+		// Number of pending entries dropped to make room for newer requests
+		uint64_t evicted() const { return _evicted; }
+
+		// True if the MN with this home address registered through the given home agent
+		// Pending entries count as well: a tunneled packet may overtake the reply
+		// Both addresses in host order
+		bool isVisitor(uint32_t homeAddress, uint32_t homeAgent) {
+			bool found = false;
+			_lock.acquire();
+			Vector<uint64_t>* identifications = _byHome.get_pointer(homeAddress);
+			for (int i = 0; identifications && i < identifications->size(); i++) {
+				VisitorEntry* entry = _visitors.get_pointer(VisitorKey(homeAddress, (*identifications)[i]));
+				if (entry->homeAgentAddress == homeAgent) {
+					found = true;
+					break;
+				}
+			}
+			_lock.release();
+			return found;
+		}
+
+		// Add a pending entry, a repeated request replaces the entry with the same key
+		// A retransmission of an accepted request only refreshes the request fields, the entry
+		// stays accepted until it expires; entry is set to the entry as it is stored
+		// At most maxPending entries of the MN stay pending, the oldest are dropped
+		void add(VisitorEntry& entry, unsigned maxPending) {
+			VisitorKey key(entry.sourceIPAddress, entry.identification);
+			_lock.acquire();
+			VisitorEntry* current = _visitors.get_pointer(key);
+			if (current && current->state == VISITOR_ACCEPTED) {
+				current->linkLayerAddress = entry.linkLayerAddress;
+				current->destinationIPAddress = entry.destinationIPAddress;
+				current->udpSourcePort = entry.udpSourcePort;
+				current->requestLifetime = entry.requestLifetime;
+				entry = *current;
+			} else if (current) {
+				*current = entry;
+				current->state = VISITOR_PENDING;
+			} else {
+				VisitorEntry& added = _visitors[key];
+				added = entry;
+				added.state = VISITOR_PENDING;
+				_byHome[entry.sourceIPAddress].push_back(entry.identification);
+				_pending++;
+			}
+			while (_countPending(entry.sourceIPAddress) > maxPending) {
+				_erase(_oldestPending(entry.sourceIPAddress));
+				_evicted++;
+			}
+			_lock.release();
+		}
+
+		// Copy the entry for key into foundEntry
+		bool find(const VisitorKey& key, VisitorEntry& foundEntry) {
+			_lock.acquire();
+			VisitorEntry* entry = _visitors.get_pointer(key);
+			if (entry)
+				foundEntry = *entry;
+			_lock.release();
+			return entry != 0;
+		}
+
+		// Delete the entry for key
+		bool erase(const VisitorKey& key) {
+			_lock.acquire();
+			bool found = _erase(key);
+			_lock.release();
+			return found;
+		}
+
+		// Delete the entry for key if it is still pending, an accepted entry stays until it expires
+		bool erasePending(const VisitorKey& key) {
+			bool found = false;
+			_lock.acquire();
+			VisitorEntry* entry = _visitors.get_pointer(key);
+			if (entry && entry->state == VISITOR_PENDING)
+				found = _erase(key);
+			_lock.release();
+			return found;
+		}
+
+		// Delete the entry for key only if it still expires at deadline
+		bool expire(const VisitorKey& key, const Timestamp& deadline) {
+			bool found = false;
+			_lock.acquire();
+			VisitorEntry* entry = _visitors.get_pointer(key);
+			if (entry && entry->expires == deadline)
+				found = _erase(key);
+			_lock.release();
+			return found;
+		}
+
+		// Apply an accepted reply for key
+		// A lifetime of 0 deregisters the MN and deletes all its entries. Otherwise the entry
+		// is accepted until expires and the older entries of the MN are deleted (RFC5944 3.7.3.2)
+		// Returns true and copies the accepted entry if there was an entry to accept
+		// The identifications of the deleted entries are added to erased, if given
+		bool accept(const VisitorKey& key, uint16_t lifetime, const Timestamp& expires, VisitorEntry& accepted, Vector<uint64_t>* erased = 0) {
+			bool found = false;
+			_lock.acquire();
+			Vector<uint64_t>* identifications = _byHome.get_pointer(key.homeAddress);
+			if (identifications) {
+				Vector<uint64_t> others;
+				for (int i = 0; i < identifications->size(); i++)
+					if ((*identifications)[i] != key.identification || lifetime == 0)
+						others.push_back((*identifications)[i]);
+				for (int i = 0; i < others.size(); i++)
+					_erase(VisitorKey(key.homeAddress, others[i]));
+				if (erased)
+					*erased = others;
+			}
+			VisitorEntry* entry = _visitors.get_pointer(key);
+			if (entry) {
+				if (entry->state == VISITOR_PENDING)
+					_pending--;
+				entry->state = VISITOR_ACCEPTED;
+				entry->expires = expires;
+				accepted = *entry;
+				found = true;
+			}
+			_lock.release();
+			return found;
+		}
+
+		// Insert an entry as it is, used to restore the visitors of a previous run
+		void restore(const VisitorEntry& entry) {
+			VisitorKey key(entry.sourceIPAddress, entry.identification);
+			_lock.acquire();
+			_erase(key);
+			_visitors[key] = entry;
+			_byHome[entry.sourceIPAddress].push_back(entry.identification);
+			if (entry.state == VISITOR_PENDING)
+				_pending++;
+			_lock.release();
+		}
+
+		// Copy all entries to out
+		void entries(Vector<VisitorEntry>& out) {
+			_lock.acquire();
+			for (HashTable<VisitorKey, VisitorEntry>::iterator it = _visitors.begin(); it != _visitors.end(); ++it)
+				out.push_back(it.value());
+			_lock.release();
+		}
+
+	private:
+		HashTable<VisitorKey, VisitorEntry> _visitors;
+		HashTable<uint32_t, Vector<uint64_t> > _byHome;
+		int _pending;
+		uint64_t _evicted;
+		Spinlock _lock;
+
+		// Remove key from both indexes, the lock is held
+		bool _erase(const VisitorKey& key) {
+			VisitorEntry* entry = _visitors.get_pointer(key);
+			if (!entry)
+				return false;
+			if (entry->state == VISITOR_PENDING)
+				_pending--;
+			_visitors.erase(key);
+			Vector<uint64_t>* identifications = _byHome.get_pointer(key.homeAddress);
+			for (int i = 0; i < identifications->size(); i++) {
+				if ((*identifications)[i] == key.identification) {
+					(*identifications)[i] = identifications->back();
+					identifications->pop_back();
+					break;
+				}
+			}
+			if (identifications->empty())
+				_byHome.erase(key.homeAddress);
+			return true;
+		}
+
+		unsigned _countPending(uint32_t homeAddress) {
+			unsigned count = 0;
+			Vector<uint64_t>* identifications = _byHome.get_pointer(homeAddress);
+			for (int i = 0; identifications && i < identifications->size(); i++)
+				if (_visitors.get_pointer(VisitorKey(homeAddress, (*identifications)[i]))->state == VISITOR_PENDING)
+					count++;
+			return count;
+		}
+
+		VisitorKey _oldestPending(uint32_t homeAddress) {
+			VisitorKey oldest;
+			Timestamp oldestExpires;
+			Vector<uint64_t>* identifications = _byHome.get_pointer(homeAddress);
+			for (int i = 0; i < identifications->size(); i++) {
+				VisitorEntry* entry = _visitors.get_pointer(VisitorKey(homeAddress, (*identifications)[i]));
+				if (entry->state == VISITOR_PENDING && (!oldestExpires || entry->expires < oldestExpires)) {
+					oldest = VisitorKey(homeAddress, (*identifications)[i]);
+					oldestExpires = entry->expires;
+				}
+			}
+			return oldest;
+		}
+};